@@ -0,0 +1,27 @@
+#include "Activity.h"
+#include <cmath>
+#include <cfloat>
+
+void ActivityTable::resize(size_t count) { scores.resize(count, 0.0f); }
+
+void ActivityTable::clear() {
+	scores.clear();
+	increment = 1.0f;
+}
+
+void ActivityTable::decay() {
+	increment *= growth;
+	if (increment > limit) rescale();
+}
+
+// Scores which would become denormal are flushed to zero. That can tie
+// them, but never reverses an order.
+void ActivityTable::rescale() {
+	for (auto& score : scores) {
+		score = std::ldexp(score, -rescaleExponent);
+		if (score < FLT_MIN) score = 0.0f;
+	}
+	increment = std::ldexp(increment, -rescaleExponent);
+}
+
+void ActivityTable::setDecay(double rho) { growth = static_cast<float>(1.0 / rho); }
@@ -0,0 +1,54 @@
+#ifndef ACTIVITY_H
+#define ACTIVITY_H
+
+#include <vector>
+#include <cstddef>
+
+// Which variables a conflict bumps.
+enum class BumpTarget {
+
+	// Every variable conflict analysis meets, as Knuth's algorithm C does.
+	Resolved,
+
+	// Only the variables of the learned clause, once it has been minimized.
+	Learned
+};
+
+// Variable activity scores, which order decisions. Instead of every score
+// decaying by rho after a conflict, the amount a bump adds grows by 1/rho,
+// which orders variables the same way. Once a score or the increment passes
+// 2^100, all of them are scaled down by that power of two with ldexp. Scaling
+// by a power of two is exact, so no two scores change order and the heap
+// stays valid. Scores are floats, sixteen to a cache line.
+class ActivityTable {
+
+public:
+
+	// Scores for variables 0 to count - 1. New variables start at zero.
+	void resize(size_t count);
+	void clear();
+
+	float operator[](int variable) const { return scores[variable]; }
+
+	// Returns true once the scores need rescaling.
+	bool bump(int variable) { return (scores[variable] += increment) > limit; }
+
+	// Called once per conflict.
+	void decay();
+
+	void rescale();
+
+	// Damping factor, 0 < rho <= 1. Lower values favour recent conflicts more.
+	void setDecay(double rho);
+
+private:
+
+	std::vector<float> scores;
+	float increment = 1.0f;
+	float growth = 1.0f / 0.9f;
+
+	static const int rescaleExponent = 100;
+	static constexpr float limit = 0x1p100f;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "BimpTable.h"
+#include <algorithm>
+
+void BimpTable::addClause(int l0, int l1, int id) {
+
+	if (packed) {
+		grow(std::max(l0, l1) + 2);
+		auto& v0 = extra[l0 ^ 1];
+		if (std::find(v0.begin(), v0.end(), l1) == v0.end()) {
+			v0.push_back(l1);
+			extraIds[l0 ^ 1].push_back(id);
+		}
+		auto& v1 = extra[l1 ^ 1];
+		if (std::find(v1.begin(), v1.end(), l0) == v1.end()) {
+			v1.push_back(l0);
+			extraIds[l1 ^ 1].push_back(id);
+		}
+	}
+	else {
+		staged.push_back(Staged{ l0 ^ 1, l1, id });
+		staged.push_back(Staged{ l1 ^ 1, l0, id });
+	}
+}
+
+// Each clause was staged as two implications; keep the one with the smaller first literal.
+std::vector<int> BimpTable::stagedClauses() const {
+	std::vector<int> literals;
+	for (auto& s : staged) {
+		if ((s.from ^ 1) > s.to) continue;
+		literals.push_back(s.from ^ 1);
+		literals.push_back(s.to);
+	}
+	return literals;
+}
+
+int BimpTable::id(int from, int to) const {
+	for (int i = offsets[from]; i < ends[from]; ++i) if (targets[i] == to) return ids[i];
+	auto& row = extra[from];
+	for (size_t i = 0; i < row.size(); ++i) if (row[i] == to) return extraIds[from][i];
+	return 0;
+}
+
+// Counting sort by source literal, then sort and deduplicate each row.
+void BimpTable::pack(int literalCount) {
+
+	for (auto& s : staged) literalCount = std::max(literalCount, std::max(s.from, s.to) + 1);
+
+	offsets.assign(literalCount + 1, 0);
+	for (auto& s : staged) offsets[s.from + 1]++;
+	for (int l = 0; l < literalCount; ++l) offsets[l + 1] += offsets[l];
+
+	// Targets and identifiers travel together until the rows are deduplicated.
+	std::vector<std::pair<int, int>> rows(staged.size());
+	std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (auto& s : staged) rows[fill[s.from]++] = { s.to, s.id };
+
+	// Squeeze out duplicates row by row. The first identifier of a duplicate is kept.
+	int write = 0;
+	for (int l = 0; l < literalCount; ++l) {
+		auto rowBegin = rows.begin() + offsets[l];
+		auto rowEnd = rows.begin() + offsets[l + 1];
+		std::stable_sort(rowBegin, rowEnd, [](auto& a, auto& b) { return a.first < b.first; });
+		auto uniqueEnd = std::unique(rowBegin, rowEnd, [](auto& a, auto& b) { return a.first == b.first; });
+		offsets[l] = write;
+		write = static_cast<int>(std::copy(rowBegin, uniqueEnd, rows.begin() + write) - rows.begin());
+	}
+	offsets[literalCount] = write;
+	ends.assign(offsets.begin() + 1, offsets.end());
+
+	targets.resize(write);
+	ids.resize(write);
+	for (int i = 0; i < write; ++i) {
+		targets[i] = rows[i].first;
+		ids[i] = rows[i].second;
+	}
+
+	staged.clear();
+	staged.shrink_to_fit();
+	extra.resize(literalCount);
+	extraIds.resize(literalCount);
+	packed = true;
+}
+
+void BimpTable::grow(int literalCount) {
+	if (literalCount + 1 > static_cast<int>(offsets.size())) offsets.resize(literalCount + 1, offsets.back());
+	if (literalCount > static_cast<int>(ends.size())) ends.resize(literalCount, offsets.back());
+	if (literalCount > static_cast<int>(extra.size())) {
+		extra.resize(literalCount);
+		extraIds.resize(literalCount);
+	}
+}
+
+void BimpTable::removeClause(int l0, int l1) {
+	removeImplication(l0 ^ 1, l1);
+	removeImplication(l1 ^ 1, l0);
+}
+
+// The last implication of the row takes the place of the one removed.
+void BimpTable::removeImplication(int from, int to) {
+
+	for (int i = offsets[from]; i < ends[from]; ++i) {
+		if (targets[i] != to) continue;
+		int last = --ends[from];
+		targets[i] = targets[last];
+		ids[i] = ids[last];
+		return;
+	}
+
+	auto& row = extra[from];
+	for (size_t i = 0; i < row.size(); ++i) {
+		if (row[i] != to) continue;
+		row[i] = row.back();
+		row.pop_back();
+		extraIds[from][i] = extraIds[from].back();
+		extraIds[from].pop_back();
+		return;
+	}
+}
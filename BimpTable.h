@@ -0,0 +1,62 @@
+#ifndef BIMPTABLE_H
+#define BIMPTABLE_H
+
+#include <vector>
+
+// Binary implication table indexed directly by encoded literal. The implications
+// of the original binary clauses are packed into one array (compressed sparse
+// row form) once the formula is loaded. Implications added afterwards go to a
+// small growable list per literal.
+class BimpTable {
+
+public:
+
+	// Record the binary clause (l0 OR l1) as the implications ~l0 -> l1 and ~l1 -> l0.
+	// The clause identifier is kept for proof logging.
+	void addClause(int l0, int l1, int id = 0);
+
+	// Move everything recorded so far into the packed array. Duplicates are dropped.
+	void pack(int literalCount);
+
+	// Make room for literals below literalCount.
+	void grow(int literalCount);
+
+	// Packed implications of a literal.
+	const int* begin(int literal) const { return targets.data() + offsets[literal]; }
+	const int* end(int literal) const { return targets.data() + ends[literal]; }
+
+	// Implications added since the table was packed.
+	const std::vector<int>& overflow(int literal) const { return extra[literal]; }
+
+	// Binary clauses recorded before packing, two literals each, once per clause.
+	std::vector<int> stagedClauses() const;
+
+	// Remove both implications of the binary clause (l0 OR l1). Rows lose their order.
+	void removeClause(int l0, int l1);
+
+	// Identifier of the clause behind the implication from -> to, or 0.
+	int id(int from, int to) const;
+
+private:
+
+	// Implications recorded before packing.
+	struct Staged { int from; int to; int id; };
+	std::vector<Staged> staged;
+
+	// Packed form. The implications of literal l are targets[offsets[l]] up to targets[ends[l]].
+	// A row ends before the next begins once implications have been removed from it.
+	// Clause identifiers sit in a parallel array so propagation never touches them.
+	std::vector<int> offsets{ 0 };
+	std::vector<int> ends;
+	std::vector<int> targets;
+	std::vector<int> ids;
+
+	std::vector<std::vector<int>> extra;
+	std::vector<std::vector<int>> extraIds;
+
+	void removeImplication(int from, int to);
+
+	bool packed = false;
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include "Dimacs.h"
+#include "ProofChecker.h"
+
+// Check a proof written by Solver::setProof against the problem it refutes.
+//
+//     Checker problem.cnf proof [--lrat]
+//
+// The proof is read as binary DRAT unless "--lrat" is given. The exit code is
+// 0 if the proof is verified and 1 otherwise.
+int main(int argc, char* argv[]) {
+
+	if (argc < 3) {
+		std::cout << "Usage: " << argv[0] << " problem.cnf proof [--lrat]\n";
+		return 1;
+	}
+
+	ProofFormat format = ProofFormat::DRAT;
+	if (argc > 3 && std::string(argv[3]) == "--lrat") format = ProofFormat::LRAT;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	Formula formula;
+	if (!readDimacs(argv[1], formula)) return 1;
+
+	ProofChecker checker(formula);
+	bool verified = checker.check(argv[2], format);
+
+	auto finish = std::chrono::high_resolution_clock::now();
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(finish - start);
+
+	if (verified) {
+		std::cout << "Proof verified. " << checker.getCheckedCount() << " lemmas checked";
+		if (format == ProofFormat::DRAT) std::cout << ", " << checker.getCoreCount() << " problem clauses in the core";
+		std::cout << ".\n";
+	}
+	else std::cout << "Proof not verified: " << checker.getError() << "\n";
+	std::cout << "Elapsed time: " << duration.count() << " ms\n";
+
+	return verified ? 0 : 1;
+}
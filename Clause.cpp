@@ -1,24 +1,45 @@
 #include "Clause.h"
 
-Clause::Clause(std::vector<int> clause) {
-	literals.reserve(clause.size());
-	literals = clause;
+// The activity is a double which spans two header words.
+double Clause::getActivity() const {
+	double a;
+	std::memcpy(&a, literals - 6, sizeof(a));
+	return a;
 }
 
-std::vector<int>& Clause::getLiterals() { return literals; }
+void Clause::setActivity(double a) { std::memcpy(literals - 6, &a, sizeof(a)); }
 
-void Clause::setClauseNumber(int c) { clauseNumber = c; }
+// Place a header and room for the literals at the end of the arena.
+int ClauseArena::allocate(int size) {
 
-int Clause::getClauseNumber() { return clauseNumber; }
+	int c = nextReference();
+	mem.resize(mem.size() + Clause::headerSize + size);
 
-int Clause::getReasonFor() { return reasonFor; }
-
-void Clause::setReasonFor(int variableNumber) { reasonFor = variableNumber; }
+	Clause clause(mem.data() + c);
+	clause.setActivity(0.0);
+	clause.setRange(0);
+	clause.setLbd(0);
+	clause.setUsed(false);
+	clause.setReasonFor(-1);
+	clause.setLearned(false);
+	clause.setId(0);
+	mem[c - 1] = size;
+	return c;
+}
 
-int Clause::getRange() { return range; }
+int ClauseArena::add(const int* literals, int size) {
+	int c = allocate(size);
+	// An empty clause may come with a null pointer, which memcpy must not see.
+	if (size > 0) std::memcpy(mem.data() + c, literals, size * sizeof(int));
+	return c;
+}
 
-void Clause::setRange(int r) { range = r; }
+// Header and literals are moved together. Regions may overlap.
+void ClauseArena::move(int from, int to) {
+	int words = mem[from - 1] + Clause::headerSize;
+	std::memmove(mem.data() + to - Clause::headerSize, mem.data() + from - Clause::headerSize, words * sizeof(int));
+}
 
-void Clause::setActivity(double a) { activity = a; }
+void ClauseArena::truncate(int c) { mem.resize(c - Clause::headerSize); }
 
-double Clause::getActivity() { return activity; }
\ No newline at end of file
+void ClauseArena::reserve(size_t words) { mem.reserve(words); }
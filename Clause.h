@@ -1,46 +1,108 @@
-
 #ifndef CLAUSE_H
 #define CLAUSE_H
 
 #include <vector>
+#include <cstring>
 
-// TODO - For added speed the solver can have a monolithic vector
-// to hold literals and instead of a vector we can have a pair of 
-// iterators that hold our beginning and end in that vector. That
-// will increase locality. 
+// A view of one clause stored inside a ClauseArena. The clause is addressed
+// by the arena offset of its first literal, and its header lives in the words
+// immediately before that literal:
+//
+//     c - 8        : identifier, used by proofs
+//     c - 7        : learned flag
+//     c - 6, c - 5 : activity (a double spread over two words)
+//     c - 4        : literal block distance, and a used bit
+//     c - 3        : range
+//     c - 2        : reasonFor
+//     c - 1        : size
+//     c ...        : literals
+//
+// Views are cheap to copy but are invalidated if the arena grows.
 class Clause {
 
 	public:
-		Clause(std::vector<int>);
-		std::vector<int>& getLiterals();
-		void setClauseNumber(int);
-		int getClauseNumber();
+		Clause(int* literals) : literals(literals) {}
+
+		// Number of words preceding the first literal.
+		static const int headerSize = 8;
+
+		int size() const { return literals[-1]; }
+		int* begin() { return literals; }
+		int* end() { return literals + literals[-1]; }
+		int& operator[](int i) { return literals[i]; }
 
-		void setReasonFor(int v);
-		int getReasonFor();
+		void setReasonFor(int v) { literals[-2] = v; }
+		int getReasonFor() const { return literals[-2]; }
 
-		int getRange();
-		void setRange(int);
+		int getRange() const { return literals[-3]; }
+		void setRange(int r) { literals[-3] = r; }
 
-		double getActivity();
+		double getActivity() const;
 		void setActivity(double);
 
+		// Learned clauses may be purged. Problem clauses added after loading
+		// share the learned part of the arena but are never purged.
+		bool getLearned() const { return literals[-7] != 0; }
+		void setLearned(bool l) { literals[-7] = l; }
+
+		// Number of distinct decision levels among the literals when the clause
+		// was learned. It decides which tier of the learned clauses it is in.
+		int getLbd() const { return literals[-4] & lbdMask; }
+		void setLbd(int lbd) { literals[-4] = (literals[-4] & usedBit) | lbd; }
+
+		// Set when the clause takes part in conflict analysis, cleared by purging.
+		bool getUsed() const { return (literals[-4] & usedBit) != 0; }
+		void setUsed(bool used) { literals[-4] = getLbd() | (used ? usedBit : 0); }
+
+		int getId() const { return literals[-8]; }
+		void setId(int id) { literals[-8] = id; }
 
 	private:
 
-		// The literals which compose this clause.
-		std::vector<int> literals;
+		// Pointer to the first literal. The header precedes it.
+		int* literals;
+
+		static const int usedBit = 1 << 30;
+		static const int lbdMask = usedBit - 1;
+};
 
-		// Index position in the clause vector.
-		int clauseNumber = -1;
+// Contiguous storage for every clause of length greater than two. Clauses
+// are appended to the back and removed only by compaction.
+class ClauseArena {
+
+	public:
 
-		// Variable which cites this clause as a reason.
-		int reasonFor = -1;
+		// Append a clause and return its reference.
+		int add(const int* literals, int size);
 
-		// properties for purging.
-		int range = 0;
-		double activity = 0.0;
+		// Append a clause whose literals the caller fills in afterwards.
+		int allocate(int size);
 
+		Clause operator[](int c) { return Clause(mem.data() + c); }
+
+		// Reference of the clause following clause 'c'.
+		int next(int c) { return c + mem[c - 1] + Clause::headerSize; }
+
+		// Reference the next clause added will receive.
+		int nextReference() const { return static_cast<int>(mem.size()) + Clause::headerSize; }
+
+		// Any valid clause reference is strictly less than this.
+		int size() const { return static_cast<int>(mem.size()); }
+
+		// Copy clause 'from' down to reference 'to', which must not be greater.
+		void move(int from, int to);
+
+		// Keep only the first 'size' literals of clause 'c'. The words freed are
+		// only reclaimed by compaction, so iterate with next() beforehand.
+		void shrink(int c, int size) { mem[c - 1] = size; }
+
+		// Discard everything from reference 'c' onward.
+		void truncate(int c);
+
+		void reserve(size_t words);
+
+	private:
+		std::vector<int> mem;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,63 @@
+#include "ClauseExchange.h"
+
+ClauseExchange::ClauseExchange(int c) : capacity(c), slots(new Slot[c]) {}
+
+uint64_t ClauseExchange::head() const { return next.load(std::memory_order_acquire); }
+
+void ClauseExchange::publish(int source, const int* literals, int size) {
+
+	if (size > maxClauseSize) return;
+
+	uint64_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots[ticket % capacity];
+
+	// Claim the slot. If another writer is still filling it, drop this clause.
+	uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+	if ((sequence & 1) || !slot.sequence.compare_exchange_strong(sequence, 2 * ticket + 1, std::memory_order_acquire)) return;
+
+	slot.source.store(source, std::memory_order_relaxed);
+	slot.size.store(size, std::memory_order_relaxed);
+	for (int i = 0; i < size; ++i) slot.literals[i].store(literals[i], std::memory_order_relaxed);
+
+	slot.sequence.store(2 * ticket + 2, std::memory_order_release);
+}
+
+int ClauseExchange::collect(int reader, uint64_t& cursor, std::vector<int>& out) const {
+
+	uint64_t end = next.load(std::memory_order_acquire);
+
+	// Anything older than one full ring has been overwritten.
+	if (end - cursor > static_cast<uint64_t>(capacity)) cursor = end - capacity;
+
+	int count = 0;
+	for (; cursor < end; ++cursor) {
+
+		const Slot& slot = slots[cursor % capacity];
+		uint64_t expected = 2 * cursor + 2;
+
+		// A writer is filling this very slot. Pick it up on the next call.
+		// Otherwise a slot without our sequence was abandoned or reused; skip it.
+		uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence == expected - 1) break;
+		if (sequence != expected) continue;
+
+		int source = slot.source.load(std::memory_order_relaxed);
+		int size = slot.size.load(std::memory_order_relaxed);
+		if (source == reader || size <= 0 || size > maxClauseSize) continue;
+
+		size_t start = out.size();
+		for (int i = 0; i < size; ++i) out.push_back(slot.literals[i].load(std::memory_order_relaxed));
+
+		// A writer overwrote the slot while we were copying. Discard the copy.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+			out.resize(start);
+			continue;
+		}
+
+		out.push_back(0);
+		++count;
+	}
+
+	return count;
+}
@@ -0,0 +1,52 @@
+#ifndef CLAUSEEXCHANGE_H
+#define CLAUSEEXCHANGE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// Fixed size ring of short learned clauses shared between portfolio workers.
+// Writers claim a slot with one atomic increment and publish it with a
+// sequence number, so nobody ever waits on a lock. Readers keep their own
+// cursor and validate each slot's sequence before and after copying it out.
+//
+// Sharing is lossy. A reader that falls more than a full ring behind skips
+// ahead, and a slot which two writers reach at once keeps only the first.
+class ClauseExchange {
+
+public:
+
+	// Longest clause a slot can carry.
+	static constexpr int maxClauseSize = 16;
+
+	ClauseExchange(int capacity = 1 << 14);
+
+	// Publish a clause of encoded literals on behalf of the given worker.
+	// Clauses longer than maxClauseSize are ignored.
+	void publish(int source, const int* literals, int size);
+
+	// Append every clause published by other workers since 'cursor' to 'out',
+	// each terminated by 0, and advance the cursor. Returns the number of clauses.
+	int collect(int reader, uint64_t& cursor, std::vector<int>& out) const;
+
+	// Ticket the next clause published will receive. Readers start here.
+	uint64_t head() const;
+
+private:
+
+	// The sequence is odd while a slot is being written and 2 * (ticket + 1)
+	// once the clause for that ticket is complete.
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 };
+		std::atomic<int> source{ -1 };
+		std::atomic<int> size{ 0 };
+		std::atomic<int> literals[maxClauseSize];
+	};
+
+	int capacity;
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<uint64_t> next{ 0 };
+};
+
+#endif
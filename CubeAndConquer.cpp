@@ -0,0 +1,250 @@
+#include "CubeAndConquer.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+CubeAndConquer::CubeAndConquer(const Formula& f, int t, int s) : formula(f), threads(t), seed(s) {
+	if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+	if (threads <= 0) threads = 1;
+}
+
+void CubeAndConquer::setDepth(int d) { depth = d; }
+
+int CubeAndConquer::getRefuted() const { return refutedCount; }
+
+std::vector<std::vector<int>> CubeAndConquer::generateCubes() {
+
+	// By default aim for a few dozen cubes per thread.
+	if (depth <= 0) {
+		depth = 5;
+		for (int t = threads; t > 1; t >>= 1) ++depth;
+	}
+
+	// Rank variables by how often they occur.
+	std::vector<int> occurrences(static_cast<size_t>(formula.variables) + 1, 0);
+	for (int l : formula.literals) if (l) occurrences[l >> 1]++;
+	candidates.clear();
+	for (int v = 1; v <= formula.variables; ++v) if (occurrences[v]) candidates.push_back(v);
+	std::stable_sort(candidates.begin(), candidates.end(), [&](int a, int b) { return occurrences[a] > occurrences[b]; });
+
+	std::vector<std::vector<int>> cubes;
+	// Lookahead runs on the problem as given, so nothing may be eliminated.
+	Solver solver(formula, seed);
+	SolverParameters parameters;
+	parameters.preprocess = false;
+	solver.setParameters(parameters);
+	if (!solver.propagate()) return cubes;
+
+	std::vector<int> path;
+	split(solver, path, cubes);
+	return cubes;
+}
+
+// Each candidate is probed both ways and scored by the product of the number of
+// literals each side sets, which favours variables that shrink both halves.
+// A side which fails is a failed literal: its complement is implied here and
+// now, and if both fail this branch has no solution.
+void CubeAndConquer::split(Solver& solver, std::vector<int>& path, std::vector<std::vector<int>>& cubes) {
+
+	if (static_cast<int>(path.size()) == depth) {
+		cubes.push_back(path);
+		return;
+	}
+
+	int best = 0;
+	long long bestScore = -1;
+	int probed = 0;
+	for (size_t i = 0; i < candidates.size() && probed < lookaheadCandidates; ++i) {
+
+		int v = candidates[i];
+		if (!solver.isFree(v)) continue;
+		++probed;
+
+		int positive = solver.probe(v);
+		int negative = solver.probe(-v);
+
+		if (positive < 0 && negative < 0) return;
+		if (positive < 0 || negative < 0) {
+			if (!solver.imply(positive < 0 ? -v : v)) return;
+			continue;
+		}
+
+		long long score = static_cast<long long>(positive) * negative;
+		if (score > bestScore) {
+			bestScore = score;
+			best = v;
+		}
+	}
+
+	// Nothing left to split on. The path is as good as a solution.
+	if (best == 0) {
+		cubes.push_back(path);
+		return;
+	}
+
+	for (int literal : { best, -best }) {
+		if (solver.openLevel(literal)) {
+			path.push_back(literal);
+			split(solver, path, cubes);
+			path.pop_back();
+		}
+		solver.closeLevel();
+	}
+}
+
+std::vector<bool> CubeAndConquer::Solve() { return Solve(generateCubes()); }
+
+std::vector<bool> CubeAndConquer::Solve(const std::vector<std::vector<int>>& cubes) {
+	std::vector<int> order(cubes.size());
+	for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+	return conquer(cubes, order, [](int) {});
+}
+
+// Each thread owns a queue of cube indices. It takes work from the back of its
+// own queue and, once that is empty, steals from the front of the others.
+template <typename Refuted>
+std::vector<bool> CubeAndConquer::conquer(const std::vector<std::vector<int>>& cubes, const std::vector<int>& order, Refuted refuted) {
+
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<int> cubes;
+	};
+
+	int workers = std::max(1, std::min(threads, static_cast<int>(order.size())));
+	std::vector<WorkQueue> queues(workers);
+	for (size_t i = 0; i < order.size(); ++i) queues[i % workers].cubes.push_back(order[i]);
+
+	std::atomic<bool> stop(false);
+	std::atomic<int> refutations(0);
+	std::mutex answerMutex;
+	std::vector<bool> answer;
+
+	auto take = [&](int worker, int& cube) {
+		for (int k = 0; k < workers; ++k) {
+			auto& queue = queues[(worker + k) % workers];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.cubes.empty()) continue;
+			if (k == 0) {
+				cube = queue.cubes.back();
+				queue.cubes.pop_back();
+			}
+			else {
+				cube = queue.cubes.front();
+				queue.cubes.pop_front();
+			}
+			return true;
+		}
+		return false;
+	};
+
+	// Each worker keeps one solver and solves its cubes as assumptions, so
+	// what it learns on one cube carries over to the next.
+	auto work = [&](int worker) {
+
+		Solver solver(formula, seed + worker);
+		solver.setStopFlag(&stop);
+
+		// Every cube is assumed sooner or later; keep its variables through preprocessing.
+		for (auto& c : cubes) for (int literal : c) solver.freeze(std::abs(literal));
+
+		int cube;
+		while (!stop.load() && take(worker, cube)) {
+
+			auto result = solver.Solve(cubes[cube]);
+
+			// Cancelled.
+			if (result.empty()) return;
+
+			std::lock_guard<std::mutex> lock(answerMutex);
+			if (result.front()) {
+				if (answer.empty()) answer = std::move(result);
+				stop.store(true);
+			}
+			else {
+				refutations++;
+				refuted(cube);
+
+				// Refuted without help from the cube. No other cube can succeed.
+				if (solver.getFailedAssumptions().empty()) stop.store(true);
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int i = 0; i < workers; ++i) pool.emplace_back(work, i);
+	for (auto& t : pool) t.join();
+
+	refutedCount = refutations.load();
+	if (answer.empty()) answer.push_back(false);
+	return answer;
+}
+
+bool CubeAndConquer::writeCubes(const std::vector<std::vector<int>>& cubes, const std::string& prefix, int shards) {
+
+	shards = std::max(shards, 1);
+	std::vector<std::ofstream> files;
+	for (int s = 0; s < shards; ++s) {
+		files.emplace_back(prefix + "." + std::to_string(s) + ".cubes");
+		if (!files.back()) return false;
+	}
+
+	for (size_t i = 0; i < cubes.size(); ++i) {
+		auto& file = files[i % shards];
+		file << "a";
+		for (int literal : cubes[i]) file << " " << literal;
+		file << " 0\n";
+	}
+
+	for (auto& file : files) {
+		file.flush();
+		if (!file) return false;
+	}
+	return true;
+}
+
+bool CubeAndConquer::readCubes(const std::string& path, std::vector<std::vector<int>>& cubes) {
+
+	std::ifstream file(path);
+	if (!file) return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream tokens(line);
+		std::string tag;
+		if (!(tokens >> tag) || tag != "a") continue;
+
+		std::vector<int> cube;
+		int literal;
+		while (tokens >> literal && literal != 0) cube.push_back(literal);
+		cubes.push_back(std::move(cube));
+	}
+	return true;
+}
+
+bool CubeAndConquer::solveFile(const std::string& cubePath, const std::string& progressPath, std::vector<bool>& solution) {
+
+	std::vector<std::vector<int>> cubes;
+	if (!readCubes(cubePath, cubes)) return false;
+
+	// Cubes refuted by earlier runs.
+	std::unordered_set<int> done;
+	{
+		std::ifstream progress(progressPath);
+		int index;
+		while (progress >> index) done.insert(index);
+	}
+
+	std::vector<int> order;
+	int count = static_cast<int>(cubes.size());
+	for (int i = 0; i < count; ++i) if (!done.count(i)) order.push_back(i);
+
+	// Called under the answer lock, so appends never interleave. Each line is
+	// flushed at once so that a crash loses at most the cubes in flight.
+	std::ofstream progress(progressPath, std::ios::app);
+	solution = conquer(cubes, order, [&](int cube) { progress << cube << std::endl; });
+	return true;
+}
@@ -0,0 +1,70 @@
+#ifndef CUBEANDCONQUER_H
+#define CUBEANDCONQUER_H
+
+#include <vector>
+#include <string>
+#include "Solver.h"
+#include "Formula.h"
+
+// Cube-and-conquer solving for problems too hard for one search. A lookahead
+// phase splits the formula into cubes, conjunctions of literals which together
+// cover every assignment. A pool of threads then solves the cubes as
+// assumptions, stealing cubes from one another as they run dry.
+class CubeAndConquer {
+
+public:
+
+	// A thread count of 0 uses every hardware thread.
+	CubeAndConquer(const Formula& formula, int threads = 0, int seed = 1);
+
+	// Number of splitting decisions per cube. 0 picks one from the thread count.
+	void setDepth(int depth);
+
+	// Split the formula by lookahead. Cubes are DIMACS literals. Refuted
+	// branches are left out, so an empty list means there is no solution.
+	std::vector<std::vector<int>> generateCubes();
+
+	// Solve the cubes, stopping at the first satisfiable one. The result is a
+	// solution as returned by Solver, or {false} once every cube is refuted.
+	std::vector<bool> Solve();
+	std::vector<bool> Solve(const std::vector<std::vector<int>>& cubes);
+
+	// Long runs can be split into batches on disk. Cubes are dealt round robin
+	// into 'shards' files named prefix.0.cubes, prefix.1.cubes and so on, one
+	// "a literal ... 0" line per cube.
+	static bool writeCubes(const std::vector<std::vector<int>>& cubes, const std::string& prefix, int shards);
+	static bool readCubes(const std::string& path, std::vector<std::vector<int>>& cubes);
+
+	// Solve the cubes of one file. The index of every refuted cube, counting
+	// cubes from 0 in file order, is appended to the progress file, and cubes
+	// already listed there are skipped, so an interrupted batch picks up where
+	// it stopped. Returns false if the cube file can't be read; otherwise
+	// 'solution' is set as by Solve. {false} means every cube in the file is
+	// refuted; the problem has no solution once every shard is.
+	bool solveFile(const std::string& cubePath, const std::string& progressPath, std::vector<bool>& solution);
+
+	// Number of cubes refuted by the last Solve.
+	int getRefuted() const;
+
+private:
+
+	// Extend 'path' by lookahead until it is 'depth' literals long.
+	void split(Solver& solver, std::vector<int>& path, std::vector<std::vector<int>>& cubes);
+
+	// Solve the given cubes, calling 'refuted' with the index of each one refuted.
+	template <typename Refuted>
+	std::vector<bool> conquer(const std::vector<std::vector<int>>& cubes, const std::vector<int>& order, Refuted refuted);
+
+	const Formula& formula;
+	int threads;
+	int seed;
+	int depth = 0;
+	int refutedCount = 0;
+
+	// Variables by decreasing number of occurrences. Lookahead probes the
+	// first few of these which are still free.
+	std::vector<int> candidates;
+	int lookaheadCandidates = 100;
+};
+
+#endif
@@ -1,17 +1,496 @@
+#include "Dimacs.h"
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <string>
-#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <climits>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <functional>
 
-std::vector<std::vector<int>> readDimacs(std::string filepath) {
+// Compressed input support is opt-in, since the library must then be linked
+// too: define SOLVER_WITH_ZLIB and link zlib for gzip, SOLVER_WITH_LZMA and
+// link liblzma for xz. Either may be a system or a vendored copy.
+#ifdef SOLVER_WITH_ZLIB
+#include <zlib.h>
+#endif
 
-	std::ifstream dimacsFile(filepath);
+#ifdef SOLVER_WITH_LZMA
+#include <lzma.h>
+#endif
 
-	std::string text;
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-	while (std::getline(dimacsFile, text)) {
-		std::istringstream iss(text);
-		std::vector<int> clause{ std::istream_iterator<int>{iss}, std::istream_iterator<int>{} };
+namespace {
+
+	// Read-only mapping of an entire file. Unmapped when it goes out of scope.
+	class MappedFile {
+
+	public:
+		MappedFile(const std::string& filepath);
+		~MappedFile();
+
+		bool isOpen() const { return open; }
+		const char* data() const { return begin; }
+		size_t size() const { return length; }
+
+	private:
+		bool open = false;
+		const char* begin = "";
+		size_t length = 0;
+
+#ifdef _WIN32
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = NULL;
+#else
+		int file = -1;
+#endif
+	};
+
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& filepath) {
+
+		file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize)) return;
+		length = static_cast<size_t>(fileSize.QuadPart);
+
+		// Empty files can't be mapped but are still valid input.
+		if (length > 0) {
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping == NULL) return;
+			begin = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (begin == nullptr) return;
+		}
+		open = true;
+	}
+
+	MappedFile::~MappedFile() {
+		if (open && length > 0) UnmapViewOfFile(begin);
+		if (mapping != NULL) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	}
+#else
+	MappedFile::MappedFile(const std::string& filepath) {
+
+		file = ::open(filepath.c_str(), O_RDONLY);
+		if (file < 0) return;
+
+		struct stat status;
+		if (fstat(file, &status) != 0) return;
+		length = static_cast<size_t>(status.st_size);
+
+		// Empty files can't be mapped but are still valid input.
+		if (length > 0) {
+			void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+			if (view == MAP_FAILED) return;
+			madvise(view, length, MADV_SEQUENTIAL);
+			begin = static_cast<const char*>(view);
+		}
+		open = true;
+	}
+
+	MappedFile::~MappedFile() {
+		if (open && length > 0) munmap(const_cast<char*>(begin), length);
+		if (file >= 0) close(file);
+	}
+#endif
+
+	bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\t' || c == '\r'; }
+	bool isDigit(char c) { return static_cast<unsigned>(c - '0') < 10; }
+
+	enum class Compression { None, Gzip, Xz };
+
+	// Look at the magic bytes at the start of the file.
+	Compression detectCompression(const char* data, size_t size) {
+		if (size >= 2 && static_cast<unsigned char>(data[0]) == 0x1f && static_cast<unsigned char>(data[1]) == 0x8b) return Compression::Gzip;
+		if (size >= 6 && std::memcmp(data, "\xfd" "7zXZ\0", 6) == 0) return Compression::Xz;
+		return Compression::None;
+	}
+
+	// Produces decompressed text on a background thread. Chunks travel through
+	// a small fixed pool of buffers, so at most a few megabytes of text exist
+	// at once no matter how large the file is.
+	class DecompressionPipeline {
+
+	public:
+
+		// Fill the buffer with up to 'capacity' bytes of text. Returns the
+		// number of bytes, 0 at the end of the stream or -1 on error.
+		typedef std::function<long long(char* buffer, size_t capacity)> Source;
+
+		DecompressionPipeline(Source source);
+		~DecompressionPipeline();
+
+		// The next chunk of text, or nullptr once the stream is exhausted.
+		// The chunk returned previously goes back to the pool.
+		const std::vector<char>* next();
+
+		bool failed() const { return error; }
+
+	private:
+		void run();
+
+		static const int bufferCount = 4;
+		static const size_t chunkSize = 1 << 20;
+
+		Source source;
+		std::vector<std::vector<char>> buffers;
+		std::deque<std::vector<char>*> full;
+		std::vector<std::vector<char>*> empty;
+		std::vector<char>* current = nullptr;
+
+		std::mutex mutex;
+		std::condition_variable changed;
+		bool finished = false;
+		bool stopping = false;
+		bool error = false;
+		std::thread worker;
+	};
+
+	DecompressionPipeline::DecompressionPipeline(Source s) : source(s), buffers(bufferCount) {
+		for (auto& b : buffers) empty.push_back(&b);
+		worker = std::thread(&DecompressionPipeline::run, this);
+	}
+
+	DecompressionPipeline::~DecompressionPipeline() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		changed.notify_all();
+		worker.join();
+	}
+
+	void DecompressionPipeline::run() {
+
+		while (true) {
+
+			// Wait for a free buffer.
+			std::vector<char>* buffer;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this] { return stopping || !empty.empty(); });
+				if (stopping) return;
+				buffer = empty.back();
+				empty.pop_back();
+			}
+
+			// Decompress outside the lock so parsing overlaps it.
+			buffer->resize(chunkSize);
+			long long produced = source(buffer->data(), chunkSize);
+			buffer->resize(produced > 0 ? static_cast<size_t>(produced) : 0);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (produced > 0) full.push_back(buffer);
+				else {
+					empty.push_back(buffer);
+					error = produced < 0;
+					finished = true;
+				}
+			}
+			changed.notify_all();
+			if (produced <= 0) return;
+		}
+	}
+
+	const std::vector<char>* DecompressionPipeline::next() {
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (current != nullptr) {
+			empty.push_back(current);
+			current = nullptr;
+			changed.notify_all();
+		}
+		changed.wait(lock, [this] { return finished || !full.empty(); });
+		if (full.empty()) return nullptr;
+		current = full.front();
+		full.pop_front();
+		return current;
+	}
+
+#ifdef SOLVER_WITH_ZLIB
+	// gzread transparently handles concatenated gzip members.
+	DecompressionPipeline::Source gzipSource(const std::string& filepath, std::shared_ptr<void>& handle) {
+		gzFile file = gzopen(filepath.c_str(), "rb");
+		if (file == nullptr) return nullptr;
+		gzbuffer(file, 1 << 17);
+		handle = std::shared_ptr<void>(file, [](void* f) { gzclose(static_cast<gzFile>(f)); });
+		return [file](char* buffer, size_t capacity) -> long long {
+			size_t total = 0;
+			while (total < capacity) {
+				int n = gzread(file, buffer + total, static_cast<unsigned>(capacity - total));
+				if (n < 0) return -1;
+				if (n == 0) break;
+				total += n;
+			}
+			return static_cast<long long>(total);
+		};
+	}
+#endif
+
+#ifdef SOLVER_WITH_LZMA
+	// State for an xz stream read through stdio.
+	struct XzStream {
+		FILE* file = nullptr;
+		lzma_stream stream = LZMA_STREAM_INIT;
+		std::vector<uint8_t> input = std::vector<uint8_t>(1 << 17);
+		bool atEnd = false;
+		~XzStream() {
+			lzma_end(&stream);
+			if (file != nullptr) fclose(file);
+		}
+	};
+
+	DecompressionPipeline::Source xzSource(const std::string& filepath, std::shared_ptr<void>& handle) {
+		auto xz = std::make_shared<XzStream>();
+		xz->file = fopen(filepath.c_str(), "rb");
+		if (xz->file == nullptr) return nullptr;
+		if (lzma_stream_decoder(&xz->stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) return nullptr;
+		handle = xz;
+		XzStream* state = xz.get();
+		return [state](char* buffer, size_t capacity) -> long long {
+			auto& stream = state->stream;
+			stream.next_out = reinterpret_cast<uint8_t*>(buffer);
+			stream.avail_out = capacity;
+			while (stream.avail_out > 0) {
+				if (stream.avail_in == 0 && !state->atEnd) {
+					stream.next_in = state->input.data();
+					stream.avail_in = fread(state->input.data(), 1, state->input.size(), state->file);
+					if (ferror(state->file)) return -1;
+					state->atEnd = feof(state->file) != 0;
+				}
+				lzma_ret status = lzma_code(&stream, state->atEnd ? LZMA_FINISH : LZMA_RUN);
+				if (status == LZMA_STREAM_END) break;
+				if (status != LZMA_OK) return -1;
+			}
+			return static_cast<long long>(capacity - stream.avail_out);
+		};
+	}
+#endif
+}
+
+DimacsParser::DimacsParser(Formula& f) : formula(f) { formula.literals.clear(); }
+
+const char* DimacsParser::fail(const char* message) {
+	std::cout << "DIMACS error on line " << line << ": " << message << "\n";
+	return nullptr;
+}
+
+bool readDimacs(const std::string& filepath, Formula& formula) {
+
+	MappedFile file(filepath);
+	if (!file.isOpen()) {
+		std::cout << "Could not open " << filepath << "\n";
+		return false;
+	}
+
+	Compression compression = detectCompression(file.data(), file.size());
+
+	// Uncompressed text is parsed straight out of the mapping.
+	if (compression == Compression::None) {
+
+		// Every literal needs a digit and a separator, so this never over-reserves
+		// by much while avoiding most regrowth on large files.
+		formula.literals.reserve(file.size() / 4);
+		return parseDimacs(file.data(), file.data() + file.size(), formula);
+	}
+
+	// Otherwise decompress on another thread and parse the chunks as they arrive.
+	std::shared_ptr<void> handle;
+	DecompressionPipeline::Source source;
+	if (compression == Compression::Gzip) {
+#ifdef SOLVER_WITH_ZLIB
+		source = gzipSource(filepath, handle);
+#else
+		std::cout << filepath << " is gzip compressed but this build has no zlib support\n";
+		return false;
+#endif
+	}
+	else {
+#ifdef SOLVER_WITH_LZMA
+		source = xzSource(filepath, handle);
+#else
+		std::cout << filepath << " is xz compressed but this build has no liblzma support\n";
+		return false;
+#endif
+	}
+	if (!source) {
+		std::cout << "Could not open " << filepath << " for decompression\n";
+		return false;
+	}
+
+	DimacsParser parser(formula);
+	DecompressionPipeline pipeline(source);
+	while (auto chunk = pipeline.next()) {
+		if (!parser.feed(chunk->data(), chunk->data() + chunk->size())) return false;
+	}
+	if (pipeline.failed()) {
+		std::cout << "Decompression of " << filepath << " failed\n";
+		return false;
+	}
+	return parser.finish();
+}
+
+bool parseDimacs(const char* begin, const char* end, Formula& formula) {
+	DimacsParser parser(formula);
+	return parser.feed(begin, end) && parser.finish();
+}
+
+bool DimacsParser::feed(const char* begin, const char* end) {
+
+	if (done) return true;
+
+	// Finish a token left over from the previous piece. A problem line runs
+	// to the end of its line, a literal to the next separator.
+	if (!carry.empty()) {
+		const char* stop = begin;
+		if (carry.front() == 'p') {
+			stop = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+			if (stop == nullptr) stop = end;
+		}
+		else {
+			while (stop < end && !isSpace(*stop)) ++stop;
+		}
+		carry.append(begin, stop);
+		if (stop == end) return true;
+		begin = stop;
+
+		if (scan(carry.data(), carry.data() + carry.size(), true) == nullptr) return false;
+		carry.clear();
+	}
+
+	const char* rest = scan(begin, end, false);
+	if (rest == nullptr) return false;
+	carry.assign(rest, end);
+	return true;
+}
+
+bool DimacsParser::finish() {
+
+	if (!carry.empty() && !done) {
+		if (scan(carry.data(), carry.data() + carry.size(), true) == nullptr) return false;
+		carry.clear();
+	}
+
+	// Accept a final clause which is missing its terminating 0.
+	if (!formula.literals.empty() && formula.literals.back() != 0) {
+		formula.literals.push_back(0);
+		++clauses;
+	}
+
+	if (!header) formula.variables = maxVariable;
+	else if (clauses != formula.clauses) {
+		std::cout << "Warning: problem line promises " << formula.clauses << " clauses but " << clauses << " were read\n";
+	}
+	formula.clauses = clauses;
+
+	return true;
+}
+
+// A hand-written scanner over the raw text. Clauses may span lines and a line
+// may hold several clauses; only the terminating 0 ends a clause.
+const char* DimacsParser::scan(const char* begin, const char* end, bool complete) {
+
+	const char* p = begin;
+
+	// Read an unsigned decimal number. Returns false on overflow or if there's no number.
+	auto readNumber = [&](int& number) {
+		if (p == end || !isDigit(*p)) return false;
+		long long value = 0;
+		while (p < end && isDigit(*p)) {
+			value = value * 10 + (*p++ - '0');
+			if (value > INT_MAX / 2 - 1) return false;
+		}
+		number = static_cast<int>(value);
+		return p == end || isSpace(*p);
+	};
+
+	auto skipBlanks = [&]() { while (p < end && (*p == ' ' || *p == '\t')) ++p; };
+
+	// Skip the rest of a comment which began in an earlier piece.
+	if (inComment) {
+		p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (p == nullptr) return end;
+		inComment = false;
+	}
+
+	while (true) {
+
+		while (p < end && isSpace(*p)) line += (*p++ == '\n');
+		if (p == end) return end;
+
+		char c = *p;
+		const char* token = p;
+
+		// Comment lines run to the end of the line.
+		if (c == 'c') {
+			p = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			if (p == nullptr) {
+				inComment = !complete;
+				return end;
+			}
+		}
+
+		// The "p cnf <variables> <clauses>" header. Used to size storage up front.
+		else if (c == 'p') {
+			const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+			if (newline == nullptr && !complete) return token;
+
+			if (header) return fail("Second problem line");
+			if (!formula.literals.empty()) return fail("Problem line after clauses");
+			++p;
+			skipBlanks();
+			if (end - p < 3 || std::memcmp(p, "cnf", 3) != 0) return fail("Expected \"p cnf\"");
+			p += 3;
+			skipBlanks();
+			if (!readNumber(formula.variables)) return fail("Bad variable count in problem line");
+			skipBlanks();
+			if (!readNumber(formula.clauses)) return fail("Bad clause count in problem line");
+			formula.literals.reserve(formula.literals.capacity() + formula.clauses);
+			header = true;
+		}
+
+		// Some benchmark sets end the clauses with a '%' line.
+		else if (c == '%') {
+			done = true;
+			return end;
+		}
+
+		// Otherwise it must be a literal or a clause-terminating 0.
+		else {
+			bool negative = c == '-';
+			if (negative) ++p;
+			int variable;
+			bool valid = readNumber(variable);
+
+			// The piece ended in the middle of the number.
+			if (p == end && !complete) return token;
+			if (!valid) return fail("Expected a literal");
+
+			if (variable == 0) {
+				formula.literals.push_back(0);
+				++clauses;
+			}
+			else {
+				if (header && variable > formula.variables) return fail("Variable exceeds the count given in the problem line");
+				maxVariable = std::max(maxVariable, variable);
+				formula.literals.push_back(2 * variable + negative);
+			}
+		}
 	}
 }
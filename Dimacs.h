@@ -0,0 +1,53 @@
+#ifndef DIMACS_H
+#define DIMACS_H
+
+#include <string>
+#include "Formula.h"
+
+// Load a DIMACS CNF file. Plain files are memory mapped and scanned in place.
+// Files compressed with gzip or xz are recognized by their magic bytes and
+// decompressed on a background thread while the text is parsed. Literals go
+// straight into the formula in the solver's encoding.
+// Returns false, after reporting why, if the file can't be read or is malformed.
+bool readDimacs(const std::string& filepath, Formula& formula);
+
+// Parse DIMACS text which is already in memory.
+bool parseDimacs(const char* begin, const char* end, Formula& formula);
+
+// Incremental DIMACS scanner. Text may be handed over in pieces of any size;
+// a literal or problem line split between two pieces is carried over.
+class DimacsParser {
+
+public:
+	DimacsParser(Formula& formula);
+
+	// Scan the next piece of input.
+	bool feed(const char* begin, const char* end);
+
+	// No more input. Checks what was read against the problem line.
+	bool finish();
+
+private:
+
+	// Scan a piece. Returns the start of a token cut off by the end of the piece
+	// (or 'end' if there is none), or nullptr on error. When 'complete' is set
+	// the end of the piece also ends the last token.
+	const char* scan(const char* begin, const char* end, bool complete);
+
+	// Report an error on the current line. Always returns nullptr.
+	const char* fail(const char* message);
+
+	Formula& formula;
+
+	// Part of a token which started in the previous piece.
+	std::string carry;
+
+	bool header = false;
+	bool inComment = false;
+	bool done = false;
+	int maxVariable = 0;
+	int clauses = 0;
+	long long line = 1;
+};
+
+#endif
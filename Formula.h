@@ -0,0 +1,18 @@
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <vector>
+
+// A CNF formula held in one flat array. Literals are already encoded the
+// solver's way (2k for k, 2k + 1 for -k) and every clause is terminated by
+// a 0, which is never a valid encoded literal.
+struct Formula {
+
+	// Number of variables and clauses. Taken from the "p cnf" header when there is one.
+	int variables = 0;
+	int clauses = 0;
+
+	std::vector<int> literals;
+};
+
+#endif
@@ -1,62 +1,95 @@
 #include "Heap.h"
 #include <iostream>
 
-struct comparison {
+void Heap::setVariables(VariableTable* v) { variables = v; }
 
-	bool operator()(const Variable* a, const Variable* b) const {
-		return a->getActivity() < b->getActivity();
-		}
-};
+void Heap::setActivities(const ActivityTable* a) { activities = a; }
 
-void Heap::push(Variable* v) {
+float Heap::activity(int variable) const { return (*activities)[variable]; }
 
-	heap.push_back(v);
-	std::push_heap(heap.begin(), heap.end(), comparison());
-	v->setHloc(true);
+void Heap::push(int variable) {
+
+	heap.push_back(variable);
+	siftUp(static_cast<int>(heap.size()) - 1);
 }
 
 // Return the largest element.
-Variable* Heap::pop(bool random) {
+int Heap::pop(bool random) {
 
-	// Occasionally place a random item on the back.
-	if (random && (rand() % 1000) < 20) {
+	// Occasionally take a random item instead of the top.
+	int index = 0;
+	if (random && static_cast<int>(generator() % 1000) < randomPickRate) index = generator() % heap.size();
 
-		int randomIndex = rand() % heap.size();
-		std::iter_swap(heap.begin() + randomIndex, heap.end() - 1);
-	}
-	// Usually put the highest activity variable on the back.
-	else {
-		std::pop_heap(heap.begin(), heap.end(), comparison());
-	}
+	int max = heap[index];
+	(*variables)[max].setHloc(-1);
 
-	Variable* max = heap.back();
+	// Fill the hole with the last element and sift it whichever way it needs to go.
+	int last = heap.back();
 	heap.pop_back();
-	max->setHloc(false);
+	if (index < static_cast<int>(heap.size())) {
+		heap[index] = last;
+		(*variables)[last].setHloc(index);
+		siftUp(index);
+		siftDown((*variables)[last].getHloc());
+	}
 	return max;
 }
 
+// A variable's activity only ever grows between rescales, so it can only move up.
+void Heap::increase(int variable) {
+	int index = (*variables)[variable].getHloc();
+	if (index >= 0) siftUp(index);
+}
+
+void Heap::siftUp(int index) {
+
+	int variable = heap[index];
+	float a = activity(variable);
+	while (index > 0) {
+		int parent = (index - 1) >> 1;
+		if (activity(heap[parent]) >= a) break;
+		heap[index] = heap[parent];
+		(*variables)[heap[index]].setHloc(index);
+		index = parent;
+	}
+	heap[index] = variable;
+	(*variables)[variable].setHloc(index);
+}
+
+void Heap::siftDown(int index) {
+
+	int variable = heap[index];
+	float a = activity(variable);
+	int size = static_cast<int>(heap.size());
+	while (true) {
+		int child = 2 * index + 1;
+		if (child >= size) break;
+		if (child + 1 < size && activity(heap[child + 1]) > activity(heap[child])) child++;
+		if (activity(heap[child]) <= a) break;
+		heap[index] = heap[child];
+		(*variables)[heap[index]].setHloc(index);
+		index = child;
+	}
+	heap[index] = variable;
+	(*variables)[variable].setHloc(index);
+}
+
 // Return the variable with the highest activity score which is
 // free. Nothing is removed from the heap. Heap is not modified.
-Variable* Heap::queryMaxFreeVariable() {
+int Heap::queryMaxFreeVariable() {
 	
-	Variable* v;
+	int v;
 	int i = 0;
 	do {
 		v = heap[i++];
-	} while (!v->isFree());
+	} while (!(*variables)[v].isFree());
 
 	return v;
 }
 
-// Intended use is to restore heap property when activity scores have
-// been externally modified by solver. 
-void Heap::reheapify() {
-
-	std::make_heap(heap.begin(), heap.end(), comparison());
-}
-
 void Heap::setSeed(int s) { 
 	seed = s;
-	srand(seed);
+	generator.seed(seed);
 }
 
+void Heap::setRandomPickRate(int perThousand) { randomPickRate = perThousand; }
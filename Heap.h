@@ -1,27 +1,50 @@
-
 #ifndef HEAP_H
 #define HEAP_H
 
 #include <vector>
-#include <stdlib.h>
-#include <algorithm>
-#include "Heap.h"
+#include <random>
 #include "Variable.h"
+#include "Activity.h"
 
+// Binary max-heap of variable numbers ordered by activity. Every variable
+// records its own position in the heap (hloc, -1 when absent), so a bumped
+// variable can be sifted into place without rebuilding the heap.
 class Heap {
 
 public:
 
+	// The variables in the heap, which record their positions, and the
+	// activities which order them.
+	void setVariables(VariableTable* v);
+	void setActivities(const ActivityTable* a);
+
 	// Remove from, and add to heap, respectively.
-	Variable* pop(bool random = false);
-	void push(Variable*);
-	void reheapify();
+	int pop(bool random = false);
+	void push(int variable);
+
+	// Restore heap order after a variable's activity has increased.
+	void increase(int variable);
+
 	void setSeed(int s);
-	Variable* queryMaxFreeVariable();
+
+	// How many pops in a thousand take a random variable instead of the top.
+	void setRandomPickRate(int perThousand);
+
+	int queryMaxFreeVariable();
 
 private:
+	void siftUp(int index);
+	void siftDown(int index);
+	float activity(int variable) const;
+
 	int seed = 0;
-	std::vector<Variable*> heap;
+	int randomPickRate = 20;
+
+	// Each heap owns its generator so solvers on different threads don't share state.
+	std::minstd_rand generator;
+	std::vector<int> heap;
+	VariableTable* variables = nullptr;
+	const ActivityTable* activities = nullptr;
 };
 
-#endif
\ No newline at end of file
+#endif
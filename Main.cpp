@@ -1,8 +1,8 @@
 #include <iostream>
 #include "Solver.h"
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include "Dimacs.h"
+#include "ParallelSolver.h"
+#include "CubeAndConquer.h"
 #include <string>
 #include <vector>
 #include <chrono>
@@ -46,30 +46,38 @@ std::vector<std::vector<int>> waerden(int j, int k, int n) {
 	return cnf;
 }
 
-std::vector<std::vector<int>> readDimacs(std::string filepath) {
-
-	std::vector<std::vector<int>> CNF;
-	std::ifstream dimacsFile(filepath);
-
-	std::string text;
+// Solve a formula with each reduction mode over the same seeds and report the
+// solve time and the rate at which conflicts were analysed.
+void benchmark(const Formula& formula, SolverParameters parameters, int runs) {
+
+	for (auto mode : { ReductionMode::FullRun, ReductionMode::Activity }) {
+
+		parameters.reduction = mode;
+		uint64_t conflicts = 0;
+		int purges = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 1; i <= runs; ++i) {
+			Solver S(formula, i);
+			S.setParameters(parameters);
+			S.Solve();
+			conflicts += S.getConflictCount();
+			purges += S.getPurgeCount();
+		}
+		auto finish = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double>(finish - start).count();
 
-	while (std::getline(dimacsFile, text)) {
-		std::istringstream iss(text);
-		std::vector<int> clause{ std::istream_iterator<int>{iss}, std::istream_iterator<int>{} };
-		if (clause.back() == 0) clause.pop_back(); // Remove trailing zero if it exists. 
-		CNF.push_back(clause);
+		std::cout << (mode == ReductionMode::FullRun ? "  full run: " : "  activity: ")
+			<< seconds << " s, " << conflicts << " conflicts, "
+			<< (seconds > 0 ? conflicts / seconds : 0) << " conflicts/s, "
+			<< purges << " purges\n";
 	}
-
-	return CNF;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
 
 	//std::vector<std::vector<int>> CNF{ {1,2}, {-1, 3}, {2, -3}, {-2, -4}, {-3, 4} }; // 1 -> false, 2 -> true, 3 -> false, 4 -> false
 	//std::vector<std::vector<int>> CNF{ {1,2,-3} , {2,3,-4} , {3,4,1} , {4,-1,2} , {-1,-2,3} , {-2,-3,4} , {-3,-4,-1} }; // Solution 1 -> false, 2 -> true, 4 -> true
 	//std::vector<std::vector<int>> CNF{ {1,2,-3} , {2,3,-4} , {3,4,1} , {4,-1,2} , {-1,-2,3} , {-2,-3,4} , {-3,-4,-1} , {-4,1,-2} }; // Unsat
-	//auto CNF = readDimacs("C:/Users/aaron/Desktop/dimacs/jnh2_unsat.cnf");
-	//auto CNF = readDimacs("C:/Users/aaron/Desktop/dimacs/jnh1_sat.cnf");
 
 	std::vector<std::string> testFiles = { "C:/Users/aaron/Desktop/dimacs/jnh2_unsat.cnf",
 										   "C:/Users/aaron/Desktop/dimacs/jnh1_sat.cnf",
@@ -83,6 +91,95 @@ int main() {
 										   "C:/Users/aaron/Desktop/dimacs/hole10_unsat.cnf"*/
 	};
 
+	// Files named on the command line replace the default list. "--threads N"
+	// runs a portfolio of N solvers per test instead of a single one; N = 0
+	// uses every hardware thread. "--cubes D" splits each test into cubes of
+	// D literals and solves those on the threads instead. "--restarts P" picks
+	// the restart policy of a single solver: agility, luby or glucose, and
+	// "--reduction R" how it purges learned clauses: fullrun or activity.
+	// "--rho X" sets the activity damping factor and "--bump B" which
+	// variables a conflict bumps: resolved or learned.
+	// "--benchmark N" solves each test N times with both reduction modes and
+	// compares them instead of running the tests.
+	// "--write-cubes PREFIX SHARDS" splits the first test into cubes, of the
+	// "--cubes" depth if given, and deals them into SHARDS files. "--solve-cubes
+	// FILE PROGRESS" solves one of those files against the first test, noting
+	// refuted cubes in PROGRESS so that a rerun resumes where it stopped.
+	int threads = 1;
+	int cubeDepth = -1;
+	int benchmarkRuns = 0;
+	std::string cubePrefix, cubeFile, progressFile;
+	int cubeShards = 0;
+	SolverParameters parameters;
+	std::vector<std::string> files;
+	for (int a = 1; a < argc; ++a) {
+		std::string arg = argv[a];
+		if (arg == "--threads" && a + 1 < argc) threads = std::stoi(argv[++a]);
+		else if (arg == "--cubes" && a + 1 < argc) cubeDepth = std::stoi(argv[++a]);
+		else if (arg == "--restarts" && a + 1 < argc) {
+			std::string policy = argv[++a];
+			if (policy == "luby") parameters.restarts = RestartKind::Luby;
+			else if (policy == "glucose") parameters.restarts = RestartKind::Glucose;
+			else parameters.restarts = RestartKind::Agility;
+		}
+		else if (arg == "--reduction" && a + 1 < argc) {
+			std::string mode = argv[++a];
+			parameters.reduction = mode == "activity" ? ReductionMode::Activity : ReductionMode::FullRun;
+		}
+		else if (arg == "--rho" && a + 1 < argc) parameters.rho = std::stod(argv[++a]);
+		else if (arg == "--bump" && a + 1 < argc) {
+			std::string target = argv[++a];
+			parameters.bump = target == "learned" ? BumpTarget::Learned : BumpTarget::Resolved;
+		}
+		else if (arg == "--benchmark" && a + 1 < argc) benchmarkRuns = std::stoi(argv[++a]);
+		else if (arg == "--write-cubes" && a + 2 < argc) {
+			cubePrefix = argv[++a];
+			cubeShards = std::stoi(argv[++a]);
+		}
+		else if (arg == "--solve-cubes" && a + 2 < argc) {
+			cubeFile = argv[++a];
+			progressFile = argv[++a];
+		}
+		else files.push_back(arg);
+	}
+	if (!files.empty()) testFiles = files;
+
+	if (benchmarkRuns > 0) {
+		for (auto file : testFiles) {
+			Formula formula;
+			if (!readDimacs(file, formula)) continue;
+			std::cout << file << ":\n";
+			benchmark(formula, parameters, benchmarkRuns);
+		}
+		return 0;
+	}
+
+	if (!cubePrefix.empty() || !cubeFile.empty()) {
+		Formula formula;
+		if (!readDimacs(testFiles.front(), formula)) return 1;
+		CubeAndConquer S(formula, threads);
+		if (cubeDepth > 0) S.setDepth(cubeDepth);
+
+		if (!cubePrefix.empty()) {
+			auto cubes = S.generateCubes();
+			if (!CubeAndConquer::writeCubes(cubes, cubePrefix, cubeShards)) {
+				std::cout << "Could not write cubes to " << cubePrefix << "\n";
+				return 1;
+			}
+			std::cout << cubes.size() << " cubes written to " << std::max(cubeShards, 1) << " files\n";
+			return 0;
+		}
+
+		std::vector<bool> solution;
+		if (!S.solveFile(cubeFile, progressFile, solution)) {
+			std::cout << "Could not read cubes from " << cubeFile << "\n";
+			return 1;
+		}
+		if (solution.front()) std::cout << "SAT\n";
+		else std::cout << "Every cube in " << cubeFile << " is refuted\n";
+		return 0;
+	}
+
 	auto start = std::chrono::high_resolution_clock::now();
 
 	std::cout << "Performing unit tests...\n\n";
@@ -90,13 +187,22 @@ int main() {
 	// Perform unit tests on each file.
 	for (auto file : testFiles) {
 
-		auto CNF = readDimacs(file);
+		Formula formula;
+		if (!readDimacs(file, formula)) continue;
 		//auto CNF = waerden(5,5,178);
 
 		// target is "true" if "unsat" not in the filename. 
 		std::cout << "\r" << file << ": 0%";
 		bool target = file.find("unsat") == std::string::npos;
 
+		// Split once per file; only the solving below varies with the seed.
+		std::vector<std::vector<int>> cubes;
+		if (cubeDepth >= 0) {
+			CubeAndConquer S(formula, threads);
+			S.setDepth(cubeDepth);
+			cubes = S.generateCubes();
+		}
+
 		int numRuns = 10000;
 		int hundredth = numRuns / 100;
 		for (int i = 1; i <= numRuns; ++i) {
@@ -104,8 +210,20 @@ int main() {
 			if (hundredth ? i % hundredth == 0 : true) std::cout << "\r" << file << ": " << (100.0 * i) / numRuns << "%";
 
 		//	std::cout << "\nRun " << i << "\n";
-			Solver S(CNF,i);
-			auto solution = S.Solve();
+			std::vector<bool> solution;
+			if (cubeDepth >= 0) {
+				CubeAndConquer S(formula, threads, i);
+				solution = S.Solve(cubes);
+			}
+			else if (threads == 1) {
+				Solver S(formula,i);
+				S.setParameters(parameters);
+				solution = S.Solve();
+			}
+			else {
+				ParallelSolver S(formula, threads, i);
+				solution = S.Solve();
+			}
 			if (solution.front() != target) {
 				std::cout << "Unit test failed on file " << file << "\n";
 				std::wcout << "Seed was: " << i << "\n";
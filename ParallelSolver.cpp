@@ -0,0 +1,70 @@
+#include "ParallelSolver.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+ParallelSolver::ParallelSolver(const Formula& f, int t, int s) : formula(f), threads(t), seed(s) {
+	if (threads <= 0) threads = static_cast<int>(std::thread::hardware_concurrency());
+	if (threads <= 0) threads = 1;
+}
+
+int ParallelSolver::getWinner() const { return winner; }
+
+void ParallelSolver::setClauseSharing(bool share) { sharing = share; }
+
+// Each list has a different length so that workers get mixed combinations
+// rather than moving through them in lockstep.
+SolverParameters ParallelSolver::diversify(int worker) {
+
+	static const double rhos[] = { 0.9, 0.95, 0.85, 0.99, 0.8 };
+	static const int capDeltas[] = { 1000, 2000, 500 };
+	static const double psis[] = { 0.05, 0.1, 0.02, 0.2 };
+	static const int randomPickRates[] = { 20, 0, 50, 10, 100, 5 };
+	static const BumpTarget bumps[] = { BumpTarget::Resolved, BumpTarget::Learned };
+
+	SolverParameters parameters;
+	parameters.rho = rhos[worker % 5];
+	parameters.capDelta = capDeltas[worker % 3];
+	parameters.psi = psis[worker % 4];
+	parameters.randomPickRate = randomPickRates[worker % 6];
+	parameters.bump = bumps[worker % 2];
+	return parameters;
+}
+
+std::vector<bool> ParallelSolver::Solve() {
+
+	std::atomic<bool> stop(false);
+	std::mutex answerMutex;
+	std::vector<bool> answer;
+	winner = -1;
+
+	// Nothing to share with a single worker.
+	ClauseExchange exchange;
+	bool share = sharing && threads > 1;
+
+	// Every worker builds its own solver so construction runs in parallel too.
+	auto work = [&](int worker) {
+
+		Solver solver(formula, seed + worker);
+		solver.setParameters(diversify(worker));
+		solver.setStopFlag(&stop);
+		if (share) solver.setClauseExchange(&exchange, worker);
+		auto result = solver.Solve();
+
+		// Cancelled.
+		if (result.empty()) return;
+
+		std::lock_guard<std::mutex> lock(answerMutex);
+		if (winner < 0) {
+			winner = worker;
+			answer = std::move(result);
+			stop.store(true);
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < threads; ++i) workers.emplace_back(work, i);
+	for (auto& w : workers) w.join();
+
+	return answer;
+}
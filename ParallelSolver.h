@@ -0,0 +1,39 @@
+#ifndef PARALLELSOLVER_H
+#define PARALLELSOLVER_H
+
+#include <vector>
+#include "Solver.h"
+#include "Formula.h"
+
+// Portfolio solver. Runs several differently configured Solver instances on
+// the same formula, one per thread. Workers pass short learned clauses to one
+// another through a ClauseExchange. The first to finish supplies the answer
+// and the rest are told to stop.
+class ParallelSolver {
+
+public:
+
+	// A thread count of 0 uses every hardware thread.
+	ParallelSolver(const Formula& formula, int threads = 0, int seed = 1);
+
+	std::vector<bool> Solve();
+
+	// Index of the worker whose answer was returned, or -1.
+	int getWinner() const;
+
+	// Clause sharing is on by default.
+	void setClauseSharing(bool share);
+
+	// Parameters for the given worker. Worker 0 uses the defaults.
+	static SolverParameters diversify(int worker);
+
+private:
+
+	const Formula& formula;
+	int threads;
+	int seed;
+	int winner = -1;
+	bool sharing = true;
+};
+
+#endif
@@ -0,0 +1,441 @@
+#include "Preprocessor.h"
+#include <algorithm>
+
+namespace {
+
+	// Remove one occurrence of a value. Order is not kept.
+	void eraseValue(std::vector<int>& values, int value) {
+		auto found = std::find(values.begin(), values.end(), value);
+		if (found != values.end()) {
+			*found = values.back();
+			values.pop_back();
+		}
+	}
+}
+
+Preprocessor::Preprocessor(const Formula& formula, const std::vector<bool>& frozenVariables) {
+
+	n = formula.variables;
+	for (int l : formula.literals) n = std::max(n, l >> 1);
+
+	frozen = frozenVariables;
+	frozen.resize(n + 1, false);
+	eliminated.assign(n + 1, false);
+	touched.assign(n + 1, true);
+	values.assign(2 * (static_cast<size_t>(n) + 1), 0);
+	occurs.resize(2 * (static_cast<size_t>(n) + 1));
+	marks.assign(2 * (static_cast<size_t>(n) + 1), 0);
+
+	std::vector<int> literals;
+	for (size_t i = 0, len = formula.literals.size(); i < len; ++i) {
+		literals.clear();
+		while (formula.literals[i] != 0) literals.push_back(formula.literals[i++]);
+		addClause(literals);
+	}
+
+	// Work is limited in proportion to the size of the formula.
+	budget = 20 * static_cast<long long>(formula.literals.size()) + 10000000;
+}
+
+void Preprocessor::run() {
+
+	propagateUnits();
+	if (!unsatisfiable) substituteEquivalences();
+	if (!unsatisfiable) subsumeQueued();
+
+	// Elimination creates clauses which may subsume others, and removing those
+	// may let more variables be eliminated.
+	for (int round = 0; round < 8 && !unsatisfiable && budget > 0; ++round) {
+		if (eliminateVariables() == 0) break;
+		subsumeQueued();
+	}
+
+	result = Formula();
+	result.variables = n;
+	if (unsatisfiable) {
+		result.literals.push_back(0);
+		result.clauses = 1;
+		return;
+	}
+
+	for (int v = 1; v <= n; ++v) {
+		if (values[2 * v] == 0) continue;
+		result.literals.push_back(values[2 * v] > 0 ? 2 * v : 2 * v + 1);
+		result.literals.push_back(0);
+		result.clauses++;
+	}
+	for (size_t c = 0; c < clauses.size(); ++c) {
+		if (removed[c]) continue;
+		result.literals.insert(result.literals.end(), clauses[c].begin(), clauses[c].end());
+		result.literals.push_back(0);
+		result.clauses++;
+	}
+
+	// Only the reconstruction stack is needed from here on.
+	clauses = std::vector<std::vector<int>>();
+	occurs = std::vector<std::vector<int>>();
+	removed = std::vector<bool>();
+	queue = std::vector<int>();
+	queued = std::vector<bool>();
+}
+
+const Formula& Preprocessor::getFormula() const { return result; }
+
+bool Preprocessor::isEliminated(int variable) const { return variable < static_cast<int>(eliminated.size()) && eliminated[variable]; }
+
+int Preprocessor::getEliminatedCount() const { return eliminatedCount; }
+
+// Removed clauses are visited latest first. Any which the solution doesn't
+// satisfy is satisfied by setting its witness.
+void Preprocessor::extend(std::vector<bool>& solution) const {
+
+	if (static_cast<int>(solution.size()) <= n) solution.resize(n + 1, false);
+
+	for (size_t i = stackStarts.size(); i-- > 0;) {
+
+		size_t start = stackStarts[i];
+		size_t end = i + 1 < stackStarts.size() ? stackStarts[i + 1] : stack.size();
+
+		bool satisfied = false;
+		for (size_t j = start + 1; j < end && !satisfied; ++j) satisfied = solution[stack[j] >> 1] != (stack[j] & 1);
+
+		int witness = stack[start];
+		if (!satisfied) solution[witness >> 1] = !(witness & 1);
+	}
+}
+
+std::vector<int> Preprocessor::getRemovedClauses() const {
+
+	std::vector<int> removedClauses;
+	for (size_t i = 0; i < stackStarts.size(); ++i) {
+		size_t end = i + 1 < stackStarts.size() ? stackStarts[i + 1] : stack.size();
+		removedClauses.insert(removedClauses.end(), stack.begin() + stackStarts[i] + 1, stack.begin() + end);
+		removedClauses.push_back(0);
+	}
+	return removedClauses;
+}
+
+void Preprocessor::addClause(std::vector<int>& literals) {
+
+	if (unsatisfiable) return;
+
+	// Sorting puts a literal next to its complement, since they differ only in the low bit.
+	std::sort(literals.begin(), literals.end());
+	literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+
+	size_t k = 0;
+	for (size_t i = 0; i < literals.size(); ++i) {
+		int l = literals[i];
+		if (values[l] > 0) return;
+		if (i + 1 < literals.size() && literals[i + 1] == (l ^ 1)) return;
+		if (values[l] < 0) continue;
+		literals[k++] = l;
+	}
+	literals.resize(k);
+
+	if (k == 0) {
+		unsatisfiable = true;
+		return;
+	}
+	if (k == 1) {
+		assign(literals[0]);
+		return;
+	}
+
+	int c = static_cast<int>(clauses.size());
+	for (int l : literals) {
+		occurs[l].push_back(c);
+		touched[l >> 1] = true;
+	}
+	clauses.push_back(literals);
+	removed.push_back(false);
+	queued.push_back(true);
+	queue.push_back(c);
+}
+
+void Preprocessor::removeClause(int c) {
+	removed[c] = true;
+	for (int l : clauses[c]) {
+		eraseValue(occurs[l], c);
+		touched[l >> 1] = true;
+	}
+	clauses[c] = std::vector<int>();
+}
+
+// A clause shortened to a unit is replaced by the assignment.
+void Preprocessor::removeLiteral(int c, int literal) {
+
+	eraseValue(clauses[c], literal);
+	eraseValue(occurs[literal], c);
+	touched[literal >> 1] = true;
+
+	if (clauses[c].size() == 1) {
+		assign(clauses[c][0]);
+		removeClause(c);
+	}
+	else if (!queued[c]) {
+		queued[c] = true;
+		queue.push_back(c);
+	}
+}
+
+void Preprocessor::assign(int literal) {
+	if (values[literal] < 0) unsatisfiable = true;
+	if (values[literal] != 0) return;
+	values[literal] = 1;
+	values[literal ^ 1] = -1;
+	units.push_back(literal);
+}
+
+bool Preprocessor::propagateUnits() {
+	while (!units.empty() && !unsatisfiable) {
+		int l = units.back();
+		units.pop_back();
+		while (!occurs[l].empty()) removeClause(occurs[l].back());
+		while (!occurs[l ^ 1].empty() && !unsatisfiable) removeLiteral(occurs[l ^ 1].back(), l ^ 1);
+	}
+	return !unsatisfiable;
+}
+
+// Literals in one strongly connected component of the binary implication graph
+// are equivalent. Tarjan's algorithm finds the components; each is replaced by
+// one representative, a frozen variable if it has one. Frozen variables are
+// never replaced themselves, so their equivalences stay as binary clauses.
+void Preprocessor::substituteEquivalences() {
+
+	size_t literalCount = 2 * (static_cast<size_t>(n) + 1);
+	std::vector<int> index(literalCount, -1);
+	std::vector<int> low(literalCount, 0);
+	std::vector<int> repr(literalCount, -1);
+	std::vector<bool> onStack(literalCount, false);
+	std::vector<int> component;
+	std::vector<int> visited;
+	std::vector<std::pair<int, size_t>> work;
+	int counter = 0;
+
+	auto visit = [&](int l) {
+		index[l] = low[l] = counter++;
+		visited.push_back(l);
+		onStack[l] = true;
+		work.emplace_back(l, 0);
+	};
+
+	for (int root = 2; root < static_cast<int>(literalCount); ++root) {
+
+		if (index[root] >= 0 || occurs[root ^ 1].empty()) continue;
+		visit(root);
+
+		while (!work.empty()) {
+
+			// The successors of u are the other literals of binary clauses containing ~u.
+			int u = work.back().first;
+			auto& list = occurs[u ^ 1];
+			bool descended = false;
+			while (work.back().second < list.size()) {
+				auto& clause = clauses[list[work.back().second++]];
+				if (clause.size() != 2) continue;
+				int v = clause[0] == (u ^ 1) ? clause[1] : clause[0];
+				if (index[v] < 0) {
+					visit(v);
+					descended = true;
+					break;
+				}
+				else if (onStack[v]) low[u] = std::min(low[u], index[v]);
+			}
+			if (descended) continue;
+
+			work.pop_back();
+			if (!work.empty()) low[work.back().first] = std::min(low[work.back().first], low[u]);
+			if (low[u] != index[u]) continue;
+
+			component.clear();
+			int v;
+			do {
+				v = visited.back();
+				visited.pop_back();
+				onStack[v] = false;
+				component.push_back(v);
+			} while (v != u);
+			if (component.size() == 1) continue;
+
+			// A literal equivalent to its own complement can't be satisfied.
+			++mark;
+			for (int l : component) marks[l] = mark;
+			for (int l : component) if (marks[l ^ 1] == mark) unsatisfiable = true;
+			if (unsatisfiable) return;
+
+			// The complement component must use the complement representative.
+			if (repr[component[0] ^ 1] >= 0) {
+				for (int l : component) repr[l] = repr[l ^ 1] ^ 1;
+				continue;
+			}
+			int representative = component[0];
+			for (int l : component) {
+				bool better = frozen[l >> 1] != frozen[representative >> 1] ? frozen[l >> 1] : (l >> 1) < (representative >> 1);
+				if (better) representative = l;
+			}
+			for (int l : component) repr[l] = frozen[l >> 1] ? l : representative;
+		}
+	}
+
+	std::vector<int> literals;
+	for (int x = 1; x <= n; ++x) {
+
+		int r = repr[2 * x];
+		if (r < 0 || r == 2 * x) continue;
+
+		eliminated[x] = true;
+		eliminatedCount++;
+		pushWitness(2 * x, { 2 * x, r ^ 1 });
+		pushWitness(2 * x + 1, { 2 * x + 1, r });
+
+		for (int l = 2 * x; l <= 2 * x + 1; ++l) {
+			while (!occurs[l].empty() && !unsatisfiable) {
+				int c = occurs[l].back();
+				literals = clauses[c];
+				removeClause(c);
+				for (int& m : literals) if (repr[m] >= 0) m = repr[m];
+				addClause(literals);
+			}
+		}
+	}
+
+	propagateUnits();
+}
+
+void Preprocessor::subsumeQueued() {
+
+	std::vector<int> batch;
+	std::vector<int> candidates;
+
+	while (!queue.empty() && budget > 0 && !unsatisfiable) {
+
+		// Short clauses first. They are the likeliest to subsume others.
+		batch.swap(queue);
+		queue.clear();
+		for (int c : batch) queued[c] = false;
+		std::stable_sort(batch.begin(), batch.end(), [&](int a, int b) { return clauses[a].size() < clauses[b].size(); });
+
+		for (int c : batch) {
+
+			if (removed[c] || budget <= 0) continue;
+			auto& clause = clauses[c];
+			int size = static_cast<int>(clause.size());
+
+			// Any clause which the clause subsumes or strengthens holds its least
+			// frequent literal or that literal's complement.
+			int best = clause[0];
+			for (int l : clause) {
+				if (occurs[l].size() + occurs[l ^ 1].size() < occurs[best].size() + occurs[best ^ 1].size()) best = l;
+			}
+			candidates = occurs[best];
+			candidates.insert(candidates.end(), occurs[best ^ 1].begin(), occurs[best ^ 1].end());
+
+			++mark;
+			for (int l : clause) marks[l] = mark;
+
+			for (int d : candidates) {
+
+				if (d == c || removed[d] || static_cast<int>(clauses[d].size()) < size) continue;
+				budget -= clauses[d].size();
+
+				int exact = 0;
+				int flips = 0;
+				int flipped = 0;
+				for (int l : clauses[d]) {
+					if (marks[l] == mark) exact++;
+					else if (marks[l ^ 1] == mark) {
+						flips++;
+						flipped = l;
+					}
+				}
+
+				if (exact == size) removeClause(d);
+				else if (flips == 1 && exact + 1 == size) removeLiteral(d, flipped);
+			}
+
+			if (!propagateUnits()) return;
+		}
+	}
+}
+
+int Preprocessor::eliminateVariables() {
+
+	// Only variables whose clauses changed since the last round can have become
+	// eliminable. Cheapest first: the fewer the resolvents, the likelier elimination pays.
+	std::vector<int> candidates;
+	for (int x = 1; x <= n; ++x) {
+		if (touched[x] && !frozen[x] && !eliminated[x] && values[2 * x] == 0) candidates.push_back(x);
+		touched[x] = false;
+	}
+	auto cost = [&](int x) { return occurs[2 * x].size() * occurs[2 * x + 1].size(); };
+	std::stable_sort(candidates.begin(), candidates.end(), [&](int a, int b) { return cost(a) < cost(b); });
+
+	int count = 0;
+	for (int x : candidates) {
+		if (budget <= 0 || unsatisfiable) break;
+		if (eliminated[x] || values[2 * x] != 0) continue;
+		count += eliminate(x);
+	}
+	return count;
+}
+
+// Replace the clauses of a variable with all their non-tautological resolvents,
+// provided there are no more resolvents than clauses and none is too long.
+bool Preprocessor::eliminate(int x) {
+
+	int p = 2 * x;
+	int q = p + 1;
+	std::vector<int> pos = occurs[p];
+	std::vector<int> neg = occurs[q];
+
+	// Pure literals never have resolvents.
+	if (!pos.empty() && !neg.empty() && (pos.size() > occurrenceLimit || neg.size() > occurrenceLimit)) return false;
+
+	std::vector<std::vector<int>> resolvents;
+	size_t limit = pos.size() + neg.size();
+	std::vector<int> resolvent;
+
+	for (int a : pos) {
+
+		++mark;
+		for (int l : clauses[a]) marks[l] = mark;
+
+		for (int b : neg) {
+
+			budget -= clauses[b].size();
+			resolvent.clear();
+			bool tautology = false;
+			for (int l : clauses[b]) {
+				if (l == q) continue;
+				if (marks[l ^ 1] == mark) {
+					tautology = true;
+					break;
+				}
+				if (marks[l] != mark) resolvent.push_back(l);
+			}
+			if (tautology) continue;
+
+			for (int l : clauses[a]) if (l != p) resolvent.push_back(l);
+			if (resolvent.size() > resolventLimit || resolvents.size() == limit) return false;
+			resolvents.push_back(resolvent);
+		}
+	}
+
+	for (int a : pos) pushWitness(p, clauses[a]);
+	for (int b : neg) pushWitness(q, clauses[b]);
+	for (int a : pos) removeClause(a);
+	for (int b : neg) removeClause(b);
+	eliminated[x] = true;
+	eliminatedCount++;
+
+	for (auto& r : resolvents) addClause(r);
+	propagateUnits();
+	return true;
+}
+
+void Preprocessor::pushWitness(int witness, const std::vector<int>& clause) {
+	stackStarts.push_back(stack.size());
+	stack.push_back(witness);
+	stack.insert(stack.end(), clause.begin(), clause.end());
+}
@@ -0,0 +1,103 @@
+#ifndef PREPROCESSOR_H
+#define PREPROCESSOR_H
+
+#include <vector>
+#include <cstddef>
+#include "Formula.h"
+
+// Simplifies a formula before search. Units are propagated, equivalent
+// literals found as strongly connected components of the binary implication
+// graph are replaced by one representative, subsumed clauses are removed and
+// others strengthened by self-subsuming resolution, and variables are
+// eliminated by resolution when that doesn't add clauses.
+//
+// Every clause removed other than by subsumption is kept on a reconstruction
+// stack together with a witness literal, so a solution of the simplified
+// formula can be extended to one of the original.
+class Preprocessor {
+
+public:
+
+	// Frozen variables are never eliminated or substituted. Variables beyond the
+	// end of 'frozen' are not frozen.
+	Preprocessor(const Formula& formula, const std::vector<bool>& frozen);
+
+	void run();
+
+	// The simplified formula. Literals fixed along the way are included as unit clauses.
+	const Formula& getFormula() const;
+
+	bool isEliminated(int variable) const;
+	int getEliminatedCount() const;
+
+	// Give eliminated variables values which satisfy every removed clause.
+	// 'solution' must satisfy the simplified formula.
+	void extend(std::vector<bool>& solution) const;
+
+	// The removed clauses, each terminated by 0. Together with the simplified
+	// formula they are equivalent to the original.
+	std::vector<int> getRemovedClauses() const;
+
+private:
+
+	// Normalize and add a clause. Tautologies and satisfied clauses are dropped,
+	// false literals removed, and units assigned.
+	void addClause(std::vector<int>& literals);
+	void removeClause(int c);
+	void removeLiteral(int c, int literal);
+	void assign(int literal);
+	bool propagateUnits();
+
+	// Equivalent literal substitution.
+	void substituteEquivalences();
+
+	// Backward subsumption and self-subsuming strengthening with each queued clause.
+	void subsumeQueued();
+
+	// Bounded variable elimination. Returns the number of variables eliminated.
+	int eliminateVariables();
+	bool eliminate(int variable);
+
+	// Record a removed clause and the literal which satisfies it on extension.
+	void pushWitness(int witness, const std::vector<int>& clause);
+
+	int n;
+	std::vector<std::vector<int>> clauses;
+	std::vector<bool> removed;
+	std::vector<std::vector<int>> occurs;
+
+	// Values of literals fixed at the top level: 1 true, -1 false, 0 free.
+	std::vector<signed char> values;
+	std::vector<int> units;
+	bool unsatisfiable = false;
+
+	std::vector<bool> frozen;
+	std::vector<bool> eliminated;
+	int eliminatedCount = 0;
+
+	// Variables whose occurrences changed since elimination last tried them.
+	std::vector<bool> touched;
+
+	// Clauses whose subsumption has yet to be tried.
+	std::vector<int> queue;
+	std::vector<bool> queued;
+
+	// Literal marks for subsumption and resolution.
+	std::vector<int> marks;
+	int mark = 0;
+
+	// Work left for subsumption and elimination, counted in literals visited.
+	long long budget = 0;
+
+	// Reconstruction stack. Entry i starts at stackStarts[i] with its witness.
+	std::vector<int> stack;
+	std::vector<size_t> stackStarts;
+
+	Formula result;
+
+	// Elimination limits.
+	static const int occurrenceLimit = 16;
+	static const int resolventLimit = 24;
+};
+
+#endif
@@ -0,0 +1,569 @@
+#include "ProofChecker.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+// Buffered reader for the binary proof format described in ProofWriter.h.
+class ProofReader {
+
+public:
+
+	ProofReader(const std::string& path) : buffer(1 << 16) { file = std::fopen(path.c_str(), "rb"); }
+	~ProofReader() { if (file) std::fclose(file); }
+
+	bool isOpen() const { return file != nullptr; }
+
+	// Next byte, or -1 at the end of the file.
+	int next() {
+		if (position == length) {
+			length = std::fread(buffer.data(), 1, buffer.size(), file);
+			position = 0;
+			if (length == 0) return -1;
+		}
+		return buffer[position++];
+	}
+
+	// Next variable-length number. False if the file ends first.
+	bool number(unsigned& value) {
+		value = 0;
+		for (int shift = 0; shift < 32; shift += 7) {
+			int c = next();
+			if (c < 0) return false;
+			value |= static_cast<unsigned>(c & 127) << shift;
+			if (c < 128) return true;
+		}
+		return false;
+	}
+
+	// Numbers up to the terminating 0.
+	bool list(std::vector<int>& values) {
+		values.clear();
+		unsigned value;
+		while (number(value)) {
+			if (value == 0) return true;
+			if (value > INT_MAX) return false;
+			values.push_back(static_cast<int>(value));
+		}
+		return false;
+	}
+
+private:
+
+	std::FILE* file = nullptr;
+	std::vector<unsigned char> buffer;
+	size_t position = 0;
+	size_t length = 0;
+};
+
+ProofChecker::ProofChecker(const Formula& formula) {
+
+	grow(formula.variables);
+	refs.push_back(0);
+
+	std::vector<int> literals;
+	for (size_t i = 0, len = formula.literals.size(); i < len; ++i) {
+		literals.clear();
+		while (formula.literals[i] != 0) literals.push_back(formula.literals[i++]);
+		if (literals.empty()) emptyProblemClause = true;
+		refs.push_back(store(literals, ++problemClauses));
+	}
+}
+
+bool ProofChecker::check(const std::string& path, ProofFormat format) {
+
+	ProofReader reader(path);
+	if (!reader.isOpen()) return fail("Could not open " + path + ".");
+
+	// An empty problem clause needs no proof.
+	if (emptyProblemClause) return true;
+
+	return format == ProofFormat::LRAT ? checkLrat(reader) : checkDrat(reader);
+}
+
+const std::string& ProofChecker::getError() const { return error; }
+
+long long ProofChecker::getCheckedCount() const { return checked; }
+
+int ProofChecker::getCoreCount() const { return coreCount; }
+
+bool ProofChecker::fail(const std::string& message) {
+	error = message;
+	return false;
+}
+
+bool ProofChecker::readLiterals(ProofReader& reader, std::vector<int>& literals) {
+	if (!reader.list(literals)) return false;
+	for (int literal : literals) {
+		if (literal < 2) return false;
+		grow(literal >> 1);
+	}
+	return true;
+}
+
+int ProofChecker::store(std::vector<int>& literals, int number) {
+	std::sort(literals.begin(), literals.end());
+	literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+	int ref = clauses.add(literals.data(), static_cast<int>(literals.size()));
+	clauses[ref].setId(number);
+	return ref;
+}
+
+bool ProofChecker::checkLrat(ProofReader& reader) {
+
+	// Clauses by identifier. Deleted clauses keep their place in the arena,
+	// with an identifier of 0, until compaction.
+	std::unordered_map<int, int> live;
+	for (int number = 1; number <= problemClauses; ++number) live.emplace(number, refs[number]);
+	refs = std::vector<int>();
+	size_t deadWords = 0;
+
+	int lastId = problemClauses;
+	std::vector<int> literals;
+	std::vector<int> hints;
+	std::vector<int> ids;
+
+	while (true) {
+
+		int type = reader.next();
+		if (type < 0) return fail("The proof ends without deriving the empty clause.");
+
+		if (type == 'a') {
+
+			unsigned id;
+			if (!reader.number(id) || (id & 1) || id / 2 > INT_MAX || !readLiterals(reader, literals) || !reader.list(hints)) {
+				return fail("Malformed clause addition after clause " + std::to_string(lastId) + ".");
+			}
+			id /= 2;
+			if (static_cast<int>(id) <= lastId) {
+				return fail("Clause identifiers must increase, but " + std::to_string(id) + " follows " + std::to_string(lastId) + ".");
+			}
+			for (int& h : hints) {
+				if (h & 1) return fail("Clause " + std::to_string(id) + " needs a RAT step, which is not supported.");
+				h /= 2;
+			}
+
+			if (!checkHints(literals, hints, live)) return fail("Clause " + std::to_string(id) + " does not follow from its hints.");
+			checked++;
+			lastId = static_cast<int>(id);
+
+			if (literals.empty()) return true;
+			live.emplace(lastId, store(literals, lastId));
+		}
+		else if (type == 'd') {
+
+			if (!reader.list(ids)) return fail("Malformed deletion after clause " + std::to_string(lastId) + ".");
+			for (int id : ids) {
+				auto found = (id & 1) ? live.end() : live.find(id / 2);
+				if (found == live.end()) return fail("Deleted clause " + std::to_string(id / 2) + " is not live.");
+				auto clause = clauses[found->second];
+				deadWords += clause.size() + Clause::headerSize;
+				clause.setId(0);
+				live.erase(found);
+			}
+
+			// Keep memory in proportion to the clauses still live.
+			if (deadWords > static_cast<size_t>(clauses.size()) / 2) {
+				compact(live);
+				deadWords = 0;
+			}
+		}
+		else return fail("Unexpected byte in the proof after clause " + std::to_string(lastId) + ".");
+	}
+}
+
+// Assume the clause false, then each hint in turn must either imply one more
+// literal or be falsified. The last must be falsified.
+bool ProofChecker::checkHints(const std::vector<int>& literals, const std::vector<int>& hints, const std::unordered_map<int, int>& live) {
+
+	size_t start = trail.size();
+	bool refuted = false;
+
+	// A clause holding a literal and its complement is trivially true.
+	for (int literal : literals) {
+		if (values[literal] == 0) assign(literal ^ 1, 0);
+		else if (values[literal] > 0) refuted = true;
+	}
+
+	for (size_t h = 0; h < hints.size() && !refuted; ++h) {
+
+		auto found = live.find(hints[h]);
+		if (found == live.end()) break;
+
+		int unit = 0;
+		int free = 0;
+		bool satisfied = false;
+		for (int literal : clauses[found->second]) {
+			if (values[literal] > 0) satisfied = true;
+			else if (values[literal] == 0) {
+				unit = literal;
+				free++;
+			}
+		}
+		if (satisfied || free > 1) break;
+
+		if (free == 0) refuted = true;
+		else assign(unit, 0);
+	}
+
+	unassign(start);
+	return refuted;
+}
+
+void ProofChecker::compact(std::unordered_map<int, int>& live) {
+
+	int write = Clause::headerSize;
+	for (int c = write; c < clauses.size();) {
+
+		int next = clauses.next(c);
+		int number = clauses[c].getId();
+		if (number != 0) {
+			if (write != c) {
+				clauses.move(c, write);
+				live[number] = write;
+			}
+			write = clauses.next(write);
+		}
+		c = next;
+	}
+	clauses.truncate(write);
+}
+
+bool ProofChecker::checkDrat(ProofReader& reader) {
+
+	// Read the whole proof. A deletion names a clause by its literals; it is
+	// matched through a hash which doesn't depend on their order. Steps are
+	// clause numbers, negative for a deletion.
+	auto hash = [&](int ref) {
+		uint64_t h = 0;
+		for (int literal : clauses[ref]) {
+			uint64_t x = static_cast<uint64_t>(literal) * 0x9E3779B97F4A7C15ull;
+			h += x ^ (x >> 29);
+		}
+		return h;
+	};
+	std::unordered_map<uint64_t, std::vector<int>> byHash;
+	for (int number = 1; number <= problemClauses; ++number) byHash[hash(refs[number])].push_back(number);
+
+	std::vector<int> steps;
+	std::vector<int> literals;
+	bool empty = false;
+	while (!empty) {
+
+		int type = reader.next();
+		if (type < 0) break;
+		if (type != 'a' && type != 'd') return fail("Unexpected byte in the proof after step " + std::to_string(steps.size()) + ".");
+		if (!readLiterals(reader, literals)) return fail("Malformed proof step after step " + std::to_string(steps.size()) + ".");
+
+		int number = static_cast<int>(refs.size());
+		int ref = store(literals, number);
+		uint64_t h = hash(ref);
+
+		if (type == 'a') {
+			refs.push_back(ref);
+			byHash[h].push_back(number);
+			steps.push_back(number);
+			empty = literals.empty();
+		}
+		else {
+			// The copy was only needed to find its match. Deletions of clauses
+			// which aren't live are ignored.
+			auto& bucket = byHash[h];
+			auto deleted = clauses[ref];
+			auto match = std::find_if(bucket.begin(), bucket.end(), [&](int candidate) {
+				auto clause = clauses[refs[candidate]];
+				return clause.size() == deleted.size() && std::equal(clause.begin(), clause.end(), deleted.begin());
+			});
+			clauses.truncate(ref);
+			if (match == bucket.end()) continue;
+
+			steps.push_back(-*match);
+			*match = bucket.back();
+			bucket.pop_back();
+		}
+	}
+	byHash.clear();
+	if (!empty) return fail("The proof ends without deriving the empty clause.");
+
+	core.assign(refs.size(), false);
+	attached.assign(refs.size(), false);
+
+	// Forward pass. Propagate at level 0 after each step until there is a conflict.
+	std::vector<int> trailSizes(steps.size(), 0);
+	int conflict = 0;
+	for (int number = 1; number <= problemClauses && !conflict; ++number) conflict = attach(number);
+	if (!conflict) conflict = propagate();
+
+	size_t s = 0;
+	for (; s < steps.size() && !conflict; ++s) {
+
+		int number = steps[s];
+		if (number > 0) {
+			if (clauses[refs[number]].size() == 0) return fail("The empty clause does not follow by unit propagation.");
+			trailSizes[s] = static_cast<int>(trail.size());
+			conflict = attach(number);
+			if (!conflict) conflict = propagate();
+		}
+		else {
+			// Deleting the reason for a level 0 literal would mean undoing the
+			// assignment. Like other checkers, ignore such deletions.
+			int ref = refs[-number];
+			int l0 = clauses[ref][0];
+			if (values[l0] > 0 && reasons[l0 >> 1] == ref) steps[s] = 0;
+			else detach(-number);
+		}
+	}
+
+	// Backward pass. Undo each step; lemmas which some conflict needed are checked
+	// against the clauses which were live when they were added.
+	markConflict(conflict);
+	while (s-- > 0) {
+
+		int number = steps[s];
+		if (number > 0) {
+			detach(number);
+			unassign(trailSizes[s]);
+			if (core[number] && !checkLemma(number)) {
+				return fail("Lemma " + std::to_string(number - problemClauses) + " does not follow by unit propagation.");
+			}
+		}
+		else if (number < 0) attach(-number);
+	}
+
+	for (int number = 1; number <= problemClauses; ++number) coreCount += core[number];
+	return true;
+}
+
+int ProofChecker::attach(int number) {
+
+	int ref = refs[number];
+	auto clause = clauses[ref];
+	int size = clause.size();
+	attached[number] = true;
+
+	if (size == 1) {
+		int l0 = clause[0];
+		if (values[l0] < 0) return ref;
+		if (values[l0] == 0) assign(l0, ref);
+		return 0;
+	}
+
+	// Watch literals which aren't false if possible, otherwise the ones falsified
+	// last. Backtracking then frees a watched literal before any other.
+	auto rank = [&](int literal) { return values[literal] >= 0 ? INT_MAX : positions[literal >> 1]; };
+	for (int w = 0; w < 2; ++w) {
+		for (int k = w + 1; k < size; ++k) if (rank(clause[k]) > rank(clause[w])) std::swap(clause[w], clause[k]);
+	}
+
+	auto& lists = core[number] ? coreWatches : watches;
+	lists[clause[0]].push_back(Watch{ ref, clause[1] });
+	lists[clause[1]].push_back(Watch{ ref, clause[0] });
+
+	if (values[clause[1]] < 0) {
+		if (values[clause[0]] < 0) return ref;
+		if (values[clause[0]] == 0) assign(clause[0], ref);
+	}
+	return 0;
+}
+
+void ProofChecker::detach(int number) {
+
+	if (!attached[number]) return;
+	attached[number] = false;
+
+	int ref = refs[number];
+	auto clause = clauses[ref];
+	if (clause.size() < 2) return;
+
+	auto& lists = core[number] ? coreWatches : watches;
+	removeWatch(lists[clause[0]], ref);
+	removeWatch(lists[clause[1]], ref);
+}
+
+void ProofChecker::removeWatch(std::vector<Watch>& watchers, int clause) {
+	for (auto& watch : watchers) {
+		if (watch.clause == clause) {
+			watch = watchers.back();
+			watchers.pop_back();
+			return;
+		}
+	}
+}
+
+int ProofChecker::propagate() {
+	while (true) {
+		while (coreHead < trail.size()) {
+			int conflict = scan(coreWatches, trail[coreHead++] ^ 1);
+			if (conflict) return conflict;
+		}
+		if (allHead == trail.size()) return 0;
+		int conflict = scan(watches, trail[allHead++] ^ 1);
+		if (conflict) return conflict;
+	}
+}
+
+// Visit the clauses watching a literal which has just become false. This is
+// the loop of Solver::checkForcing, with every level treated alike.
+int ProofChecker::scan(std::vector<std::vector<Watch>>& lists, int falsified) {
+
+	auto& watchers = lists[falsified];
+	Watch* i = watchers.data();
+	Watch* j = i;
+	Watch* end = i + watchers.size();
+
+	while (i != end) {
+
+		Watch watch = *i++;
+		if (values[watch.blocker] > 0) {
+			*j++ = watch;
+			continue;
+		}
+
+		auto clause = clauses[watch.clause];
+		int* literals = clause.begin();
+		int size = clause.size();
+		if (literals[1] != falsified) std::swap(literals[0], literals[1]);
+
+		int l0 = literals[0];
+		if (values[l0] > 0) {
+			*j++ = Watch{ watch.clause, l0 };
+			continue;
+		}
+
+		bool moved = false;
+		for (int k = 2; k < size; ++k) {
+			int lk = literals[k];
+			if (values[lk] >= 0) {
+				std::swap(literals[1], literals[k]);
+				lists[lk].push_back(Watch{ watch.clause, l0 });
+				moved = true;
+				break;
+			}
+		}
+		if (moved) continue;
+
+		*j++ = Watch{ watch.clause, l0 };
+		if (values[l0] == 0) assign(l0, watch.clause);
+		else {
+			while (i != end) *j++ = *i++;
+			watchers.resize(j - watchers.data());
+			return watch.clause;
+		}
+	}
+
+	watchers.resize(j - watchers.data());
+	return 0;
+}
+
+bool ProofChecker::checkLemma(int number) {
+
+	checked++;
+	size_t start = trail.size();
+	auto clause = clauses[refs[number]];
+
+	// A lemma already satisfied at level 0 follows from the reasons of that literal.
+	for (int literal : clause) {
+		if (values[literal] > 0) {
+			markReasons(&literal, 1);
+			return true;
+		}
+	}
+
+	bool refuted = false;
+	for (int literal : clause) {
+		if (values[literal] == 0) assign(literal ^ 1, 0);
+		else if (values[literal] > 0) refuted = true;
+	}
+
+	if (!refuted) {
+		int conflict = propagate();
+		if (conflict) markConflict(conflict);
+		refuted = conflict != 0;
+	}
+
+	unassign(start);
+	return refuted;
+}
+
+void ProofChecker::markConflict(int clause) {
+	markCore(clause);
+	auto conflictClause = clauses[clause];
+	markReasons(conflictClause.begin(), conflictClause.size());
+}
+
+// Walk back along the trail from the literals given, marking every reason met.
+void ProofChecker::markReasons(const int* literals, int size) {
+
+	int pending = 0;
+	for (int i = 0; i < size; ++i) {
+		int variable = literals[i] >> 1;
+		if (!seen[variable]) {
+			seen[variable] = true;
+			pending++;
+		}
+	}
+
+	for (size_t t = trail.size(); pending > 0 && t-- > 0;) {
+
+		int variable = trail[t] >> 1;
+		if (!seen[variable]) continue;
+		seen[variable] = false;
+		pending--;
+
+		int reason = reasons[variable];
+		if (reason == 0) continue;
+		markCore(reason);
+		for (int literal : clauses[reason]) {
+			int v = literal >> 1;
+			if (v != variable && !seen[v]) {
+				seen[v] = true;
+				pending++;
+			}
+		}
+	}
+}
+
+// Move a clause's watches over to the lists propagated first.
+void ProofChecker::markCore(int clause) {
+
+	auto c = clauses[clause];
+	int number = c.getId();
+	if (core[number]) return;
+	core[number] = true;
+
+	if (attached[number] && c.size() >= 2) {
+		removeWatch(watches[c[0]], clause);
+		removeWatch(watches[c[1]], clause);
+		coreWatches[c[0]].push_back(Watch{ clause, c[1] });
+		coreWatches[c[1]].push_back(Watch{ clause, c[0] });
+	}
+}
+
+void ProofChecker::assign(int literal, int reason) {
+	values[literal] = 1;
+	values[literal ^ 1] = -1;
+	reasons[literal >> 1] = reason;
+	positions[literal >> 1] = static_cast<int>(trail.size());
+	trail.push_back(literal);
+}
+
+void ProofChecker::unassign(size_t trailSize) {
+	while (trail.size() > trailSize) {
+		int literal = trail.back();
+		trail.pop_back();
+		values[literal] = 0;
+		values[literal ^ 1] = 0;
+	}
+	coreHead = std::min(coreHead, trailSize);
+	allHead = std::min(allHead, trailSize);
+}
+
+void ProofChecker::grow(int variable) {
+	size_t count = static_cast<size_t>(variable) + 1;
+	if (reasons.size() >= count) return;
+	values.resize(2 * count, 0);
+	watches.resize(2 * count);
+	coreWatches.resize(2 * count);
+	reasons.resize(count, 0);
+	positions.resize(count, 0);
+	seen.resize(count, false);
+}
@@ -0,0 +1,119 @@
+#ifndef PROOFCHECKER_H
+#define PROOFCHECKER_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include "Clause.h"
+#include "Variable.h"
+#include "Formula.h"
+#include "ProofWriter.h"
+
+class ProofReader;
+
+// Checks a binary DRAT or LRAT proof, as written by ProofWriter, against the
+// formula it refutes. Every clause a proof adds must be a reverse unit
+// propagation (RUP) consequence of the clauses live at that point.
+//
+// LRAT proofs are checked forward while they are read. The hints name the
+// clauses to propagate, in order, so no search is needed, and only clauses
+// which are still live are kept.
+//
+// DRAT proofs are checked backward. A forward pass propagates at level 0
+// until the clauses conflict; from there the proof is undone one step at a
+// time and only the lemmas which took part in a conflict are checked. When
+// checking a lemma, clauses already known to be needed are propagated first,
+// which keeps the set of lemmas to check small. Backward checking has to keep
+// every lemma the proof adds, but each is stored only once.
+class ProofChecker {
+
+public:
+
+	ProofChecker(const Formula& formula);
+
+	// Returns true if the proof derives the empty clause. If not, getError says why.
+	bool check(const std::string& path, ProofFormat format);
+
+	const std::string& getError() const;
+
+	// Number of lemmas whose derivation was checked.
+	long long getCheckedCount() const;
+
+	// Number of problem clauses the refutation depends on. DRAT only.
+	int getCoreCount() const;
+
+private:
+
+	bool checkLrat(ProofReader& reader);
+	bool checkDrat(ProofReader& reader);
+
+	// Read a 0-terminated list of literals, making room for their variables.
+	bool readLiterals(ProofReader& reader, std::vector<int>& literals);
+
+	// Store a clause in the arena under the given number. Duplicate literals are
+	// dropped and the rest sorted, so equal clauses are stored identically.
+	int store(std::vector<int>& literals, int number);
+
+	// True if the LRAT hints propagate the negation of 'literals' to a conflict.
+	bool checkHints(const std::vector<int>& literals, const std::vector<int>& hints, const std::unordered_map<int, int>& live);
+
+	// Slide live clauses down over deleted ones. LRAT only.
+	void compact(std::unordered_map<int, int>& live);
+
+	// Watch a clause and propagate what it implies at once. Returns the
+	// clause if it is falsified, otherwise 0.
+	int attach(int clauseNumber);
+	void detach(int clauseNumber);
+	void removeWatch(std::vector<Watch>& watchers, int clause);
+
+	// Unit propagation over the watches. Clauses needed by earlier checks are
+	// propagated to a fixed point before any other clause is looked at.
+	// Returns the falsified clause, or 0.
+	int propagate();
+	int scan(std::vector<std::vector<Watch>>& lists, int falsified);
+
+	// Is the lemma a RUP consequence of the clauses now attached?
+	bool checkLemma(int clauseNumber);
+
+	// Mark the clauses behind a conflict, or behind the given literals, as needed.
+	void markConflict(int clause);
+	void markReasons(const int* literals, int size);
+	void markCore(int clause);
+
+	void assign(int literal, int reason);
+	void unassign(size_t trailSize);
+	void grow(int variable);
+
+	bool fail(const std::string& message);
+
+	// Every clause is in the arena. Clauses are numbered from 1 in the order they
+	// arrive, problem clauses first; the number is kept in the identifier word.
+	ClauseArena clauses;
+	std::vector<int> refs;
+	int problemClauses = 0;
+	bool emptyProblemClause = false;
+
+	// Level 0 assignment, followed by any literals assumed while checking a lemma.
+	// Values are indexed by literal: 1 true, -1 false, 0 free.
+	std::vector<signed char> values;
+	std::vector<int> reasons;
+	std::vector<int> positions;
+	std::vector<int> trail;
+	std::vector<bool> seen;
+	size_t coreHead = 0;
+	size_t allHead = 0;
+
+	// Watches are indexed by the watched literal. Clauses needed for the
+	// refutation are watched in coreWatches, the rest in watches.
+	std::vector<std::vector<Watch>> watches;
+	std::vector<std::vector<Watch>> coreWatches;
+	std::vector<bool> core;
+	std::vector<bool> attached;
+
+	std::string error;
+	long long checked = 0;
+	int coreCount = 0;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "ProofWriter.h"
+
+ProofWriter::ProofWriter(const std::string& path, ProofFormat f) : format(f) {
+	file = std::fopen(path.c_str(), "wb");
+	if (!file) return;
+	front.reserve(bufferSize + 1024);
+	back.reserve(bufferSize + 1024);
+	writer = std::thread(&ProofWriter::writeLoop, this);
+}
+
+ProofWriter::~ProofWriter() {
+	if (!file) return;
+	flush();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+	changed.notify_all();
+	writer.join();
+	std::fclose(file);
+}
+
+bool ProofWriter::isOpen() const { return file != nullptr; }
+
+ProofFormat ProofWriter::getFormat() const { return format; }
+
+void ProofWriter::put(unsigned value) {
+	while (value > 127) {
+		front.push_back(static_cast<unsigned char>((value & 127) | 128));
+		value >>= 7;
+	}
+	front.push_back(static_cast<unsigned char>(value));
+}
+
+void ProofWriter::add(int id, const int* literals, int size, const std::vector<int>& hints) {
+
+	front.push_back('a');
+	if (format == ProofFormat::LRAT) put(2u * id);
+	for (int i = 0; i < size; ++i) put(literals[i]);
+	put(0);
+	if (format == ProofFormat::LRAT) {
+		for (int h : hints) put(2u * h);
+		put(0);
+	}
+
+	if (front.size() >= bufferSize) handOff();
+}
+
+void ProofWriter::remove(int id, const int* literals, int size) {
+
+	front.push_back('d');
+	if (format == ProofFormat::LRAT) put(2u * id);
+	else for (int i = 0; i < size; ++i) put(literals[i]);
+	put(0);
+
+	if (front.size() >= bufferSize) handOff();
+}
+
+// Wait for the writer to finish with the back buffer, then trade.
+void ProofWriter::handOff() {
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [&] { return !backFull; });
+	std::swap(front, back);
+	backFull = true;
+	lock.unlock();
+	changed.notify_all();
+}
+
+void ProofWriter::flush() {
+	if (!file) return;
+	if (!front.empty()) handOff();
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [&] { return !backFull; });
+	std::fflush(file);
+}
+
+void ProofWriter::writeLoop() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		changed.wait(lock, [&] { return backFull || closing; });
+		if (backFull) {
+
+			// The solver never touches 'back' while it is full, so write without the lock.
+			lock.unlock();
+			std::fwrite(back.data(), 1, back.size(), file);
+			back.clear();
+			lock.lock();
+			backFull = false;
+			changed.notify_all();
+		}
+		else if (closing) return;
+	}
+}
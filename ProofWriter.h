@@ -0,0 +1,65 @@
+#ifndef PROOFWRITER_H
+#define PROOFWRITER_H
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+enum class ProofFormat { DRAT, LRAT };
+
+// Writes a binary DRAT or LRAT proof. Every number is written as a
+// variable-length unsigned integer, seven bits to a byte, low bits first.
+// A literal is 2 * variable + sign, which is the solver's own encoding, and
+// a clause identifier i is written as 2 * i.
+//
+//     DRAT:  'a' literals 0              'd' literals 0
+//     LRAT:  'a' id literals 0 hints 0   'd' ids 0
+//
+// Output is collected in one buffer while a background thread writes out
+// the other, so the solver only waits if the disk falls a buffer behind.
+class ProofWriter {
+
+public:
+
+	ProofWriter(const std::string& path, ProofFormat format);
+	~ProofWriter();
+
+	bool isOpen() const;
+	ProofFormat getFormat() const;
+
+	// Record a clause which follows from the ones before it. DRAT ignores the
+	// identifier and hints; LRAT hints list the clauses which, in order,
+	// propagate to a conflict under the negation of the new clause.
+	void add(int id, const int* literals, int size, const std::vector<int>& hints);
+
+	// Record that a clause is no longer needed.
+	void remove(int id, const int* literals, int size);
+
+	// Block until everything recorded so far is on disk.
+	void flush();
+
+private:
+
+	void put(unsigned value);
+	void handOff();
+	void writeLoop();
+
+	std::FILE* file = nullptr;
+	ProofFormat format;
+
+	// 'front' is filled by the solver; 'back' belongs to the writer thread while 'backFull' is set.
+	std::vector<unsigned char> front;
+	std::vector<unsigned char> back;
+	bool backFull = false;
+	bool closing = false;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::thread writer;
+
+	static const size_t bufferSize = 1 << 20;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "RestartPolicy.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+	// Checks fall at reluctant doubling intervals, and the search restarts at
+	// a check only if agility is below a threshold. The threshold is reset to
+	// psi with each new doubling run and raised by 1/16 at every step of it.
+	class AgilityRestarts : public RestartPolicy {
+
+	public:
+
+		AgilityRestarts(double psi) : psi(psi) {}
+
+		void learned(int) override { conflicts++; }
+
+		bool due(int32_t agility) override {
+
+			if (conflicts < threshold) return false;
+
+			threshold += v;
+			if ((u & -u) == v) {
+				u++;
+				v = 1;
+				thetaF = static_cast<uint64_t>(std::pow(2, 32) * psi);
+			}
+			else {
+				v *= 2;
+				thetaF += (thetaF >> 4);
+			}
+
+			// Agility is a fraction of 2^32, so its bits read as unsigned.
+			return static_cast<uint32_t>(agility) <= thetaF;
+		}
+
+	private:
+
+		double psi;
+		uint64_t conflicts = 0;
+		uint64_t threshold = 1;
+		int u = 1;
+		int v = 1;
+		uint64_t thetaF = 1;
+	};
+
+	// Knuth's reluctant doubling pairs (u, v) run through the Luby sequence in v.
+	class LubyRestarts : public RestartPolicy {
+
+	public:
+
+		LubyRestarts(int unit) : unit(unit) {}
+
+		void learned(int) override { conflicts++; }
+
+		bool due(int32_t) override {
+
+			if (conflicts < static_cast<uint64_t>(unit) * v) return false;
+
+			conflicts = 0;
+			if ((u & -u) == v) {
+				u++;
+				v = 1;
+			}
+			else v *= 2;
+			return true;
+		}
+
+	private:
+
+		int unit;
+		uint64_t conflicts = 0;
+		int64_t u = 1;
+		int64_t v = 1;
+	};
+
+	// Exponential moving averages of the LBD over roughly the last 32 and
+	// the last 4096 learned clauses. A few conflicts must pass between restarts
+	// so the fast average reflects the new search.
+	class GlucoseRestarts : public RestartPolicy {
+
+	public:
+
+		void learned(int lbd) override {
+			conflicts++;
+			fast += (lbd - fast) / std::min<double>(static_cast<double>(conflicts), 32);
+			slow += (lbd - slow) / std::min<double>(static_cast<double>(conflicts), 4096);
+		}
+
+		bool due(int32_t) override {
+			if (conflicts - lastRestart < minimumInterval || fast <= margin * slow) return false;
+			lastRestart = conflicts;
+			return true;
+		}
+
+	private:
+
+		static constexpr double margin = 1.25;
+		static const int minimumInterval = 50;
+
+		double fast = 0;
+		double slow = 0;
+		uint64_t conflicts = 0;
+		uint64_t lastRestart = 0;
+	};
+}
+
+std::unique_ptr<RestartPolicy> makeRestartPolicy(RestartKind kind, double psi, int lubyUnit) {
+	switch (kind) {
+		case RestartKind::Luby: return std::make_unique<LubyRestarts>(lubyUnit);
+		case RestartKind::Glucose: return std::make_unique<GlucoseRestarts>();
+		default: return std::make_unique<AgilityRestarts>(psi);
+	}
+}
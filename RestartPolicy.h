@@ -0,0 +1,41 @@
+#ifndef RESTARTPOLICY_H
+#define RESTARTPOLICY_H
+
+#include <memory>
+#include <cstdint>
+
+enum class RestartKind {
+
+	// Knuth's flushing: reluctant doubling intervals, taken only while agility is low.
+	Agility,
+
+	// Intervals following the Luby sequence 1, 1, 2, 1, 1, 2, 4, ... times a unit.
+	Luby,
+
+	// Restart when the recent average LBD of learned clauses exceeds the long
+	// term average by a margin, as Glucose does.
+	Glucose
+};
+
+// Decides when the search should restart. The solver reports every clause it
+// learns and asks between decisions. Restarts reuse the trail: levels whose
+// decisions would be made again straight away are kept.
+class RestartPolicy {
+
+public:
+
+	virtual ~RestartPolicy() = default;
+
+	// A clause was learned with the given literal block distance (number of
+	// distinct decision levels among its literals).
+	virtual void learned(int lbd) = 0;
+
+	// Should the search restart now? 'agility' is the solver's measure of how
+	// often recent assignments changed polarity, with 2^32 meaning always.
+	virtual bool due(int32_t agility) = 0;
+};
+
+// 'psi' is the agility threshold for Agility, 'lubyUnit' the conflicts per Luby step.
+std::unique_ptr<RestartPolicy> makeRestartPolicy(RestartKind kind, double psi, int lubyUnit);
+
+#endif
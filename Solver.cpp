@@ -1,4 +1,5 @@
 #include "Solver.h"
+#include "WatchScan.h"
 #include <iostream>
 #include <random>
 #include <chrono>
@@ -7,134 +8,340 @@
 
 //#define DEBUG
 
-// Solver constructor. Initializes variables, loads clauses, and processes
-// unit clauses. 
-Solver::Solver(cnf CNF, int seedArgument) {
+// Solver constructor. Clauses are supplied afterwards through addClause.
+// The seed is used once the problem is complete.
+Solver::Solver(int seedArgument) {
+
+	// Get our random generator seed. Use supplied argument if provided, else generate a random seed.
+	if (seedArgument < 0) seed = static_cast<int>(std::chrono::system_clock::now().time_since_epoch().count());
+	else seed = seedArgument;
 
 	// We will use 1-based indexing to align with Knuth's text.
 	// Create dummy entries here.
-	variables.reserve(10000000);
-	variables.push_back(Variable(0));
-	clauses.reserve(10000000);
-	clauses.push_back(Clause({}));
+	// Clause references are arena offsets and are always positive, so a
+	// reason of 0 still means "no reason".
+	variables.resize(1);
+	activity.resize(1);
 	levels.emplace_back(0); // Level 0 (level k is at levels[k] ) always starts at trail index 0.
+}
 
-	// Loop through the CNF and process each clause within.
-	for (auto& clause : CNF) {
-
-		// This sat solver encodes literals such that a positive literal l becomes 2*l
-		// and a negative literal l becomes 2*l + 1
-		std::vector<int> encoded(clause);
-		std::transform(clause.begin(), clause.end(), encoded.begin(), [](int a) {return 2 * std::abs(a) + (a < 0); });
+// Load every clause of a CNF. Initializes variables, loads clauses, and
+// processes unit clauses. 
+Solver::Solver(const cnf& CNF, int seedArgument) : Solver(seedArgument) {
+	for (auto& clause : CNF) addClause(clause);
+}
 
-		// Ensure that a variable object exists corresponding to each literal in the clause.
-		for (auto& literal : encoded) {
-			size_t variableNumber = literal >> 1;
-			while (variables.size() <= variableNumber) variables.emplace_back(Variable(variables.size()));
+// Load a formula which is already encoded. Its header determines how many
+// variables there are, including any which appear in no clause, and storage
+// is sized from the literals actually present.
+Solver::Solver(const Formula& formula, int seedArgument) : Solver(seedArgument) {
+
+	reserve(formula.variables, formula.clauses);
+	clauses.reserve(formula.literals.size() + Clause::headerSize * static_cast<size_t>(formula.clauses));
+	addVariables(formula.variables);
+
+	// Count how many long clauses will watch each literal so every watch
+	// list is allocated once at its final size.
+	std::vector<int> watchCounts(2 * (static_cast<size_t>(formula.variables) + 1), 0);
+	for (size_t i = 0, len = formula.literals.size(); i < len; ++i) {
+		size_t start = i;
+		while (formula.literals[i] != 0) ++i;
+		if (i - start > 2) {
+			watchCounts[formula.literals[start]]++;
+			watchCounts[formula.literals[start + 1]]++;
 		}
+	}
+	for (int v = 1; v <= formula.variables; ++v) vfv(v).reserveWatches(watchCounts[2 * v], watchCounts[2 * v + 1]);
 
-		// Add the clause to our collection of clauses. Stored encoded via "2k/2k+1" scheme.
-		switch (encoded.size()) {
+	for (size_t i = 0, len = formula.literals.size(); i < len; ++i) {
+		size_t start = i;
+		while (formula.literals[i] != 0) ++i;
+		loadClause(formula.literals.data() + start, static_cast<int>(i - start));
+	}
+}
 
-			// Empty clauses cause immediate failure.
-			case 0:
-				std::cout << "Empty clause found in solver initialization. No solution possible.";
-				std::cin.get();
-				exit(1);
-				break;
+void Solver::setParameters(const SolverParameters& parameters) {
+	activity.setDecay(parameters.rho);
+	bumpTarget = parameters.bump;
+	capDelta = parameters.capDelta;
+	purgeThreshold = capDelta;
+	reduction = parameters.reduction;
+	restartPolicy = makeRestartPolicy(parameters.restarts, parameters.psi, parameters.lubyUnit);
+	heap.setRandomPickRate(parameters.randomPickRate);
+	shareSize = std::min(parameters.shareSize, ClauseExchange::maxClauseSize);
+	shareRange = parameters.shareRange;
+	preprocessing = parameters.preprocess;
+	probeEffort = parameters.probeEffort;
+	vivifyEffort = parameters.vivifyEffort;
+}
+
+void Solver::setStopFlag(const std::atomic<bool>* flag) { stopFlag = flag; }
 
-			// Unit clauses go strait to trail if no contradiction found, otherwise fail.
-			// Watch lists are not set for unit clauses.
-			case 1: {
-				auto literal = encoded.front();
-				auto& variable = vfl(literal);
+bool Solver::setProof(const std::string& path, ProofFormat format) {
+	proof = std::make_unique<ProofWriter>(path, format);
+	if (!proof->isOpen()) {
+		proof.reset();
+		return false;
+	}
+	lrat = format == ProofFormat::LRAT;
+	return true;
+}
 
-				// Mismatch if not free and polarity does not match.
-				bool contradiction = variable.isFree() ? false : (variable.getValue() + literal) & 1;
+void Solver::setClauseExchange(ClauseExchange* e, int source) {
+	exchange = e;
+	exchangeSource = source;
+	exchangeCursor = e->head();
+}
 
-				// Place literal on trail if it is not a mismatch.
-				if (contradiction) {
-					std::cout << "Contradiction between unit clauses. No solution found in initialization.";
-					std::cin.get();
-					exit(1);
-				}
-				else {
-					// Add the literal to trail. No reason for unit clauses.
-					addForcedLiteralToTrail(literal, 0);
-				}
-				break; }
-				  // Binary clauses go into the bimp table.
-			case 2: {
-
-				auto l0 = encoded[0];
-				auto notl0 = l0 ^ 1;
-				auto l1 = encoded[1];
-				auto notl1 = l1 ^ 1;
-
-				// Ensure entries exist for their complements.
-				if (!bimp.count(notl0)) bimp.emplace(notl0, std::vector<int>());
-				if (!bimp.count(notl1)) bimp.emplace(notl1, std::vector<int>());
-
-				// Add l1 to not v0 vector if not already present.
-				auto& v0 = bimp[notl0];
-				auto loc = std::find(v0.begin(), v0.end(), l1);
-				if (loc == v0.end()) v0.emplace_back(l1);
-
-				// Repeat for v1.
-				auto& v1 = bimp[notl1];
-				loc = std::find(v1.begin(), v1.end(), l0);
-				if (loc == v1.end()) v1.emplace_back(l0);
-				break;
+// Size storage for a problem of the given dimensions. The arena estimate
+// assumes three literals per clause; it only avoids regrowth and isn't a limit.
+void Solver::reserve(int variableCount, int clauseCount) {
+	variables.reserve(static_cast<size_t>(variableCount) + 1);
+	trail.reserve(variableCount);
+	clauses.reserve(static_cast<size_t>(clauseCount) * (Clause::headerSize + 3));
+}
+
+// Add a clause given in DIMACS form (k for x_k, -k for its complement). Long
+// clauses are encoded straight into the arena; no temporary copy is made.
+void Solver::addClause(std::span<const int> clause) {
+
+	auto encode = [](int a) { return 2 * std::abs(a) + (a < 0); };
+
+	// Ensure that a variable object exists corresponding to each literal in the clause.
+	int largest = 0;
+	for (int literal : clause) largest = std::max(largest, std::abs(literal));
+	addVariables(largest);
+
+	// Between calls to Solve, go back to level 0 where the clause can be
+	// simplified and installed without disturbing the watches.
+	if (loaded) {
+		if (depth() > 0) backjump(0);
+		if (preprocessor && std::any_of(clause.begin(), clause.end(), [&](int a) { return preprocessor->isEliminated(std::abs(a)); })) restoreEliminated();
+		std::vector<int> encoded(clause.size() + 1, 0);
+		for (size_t i = 0; i < clause.size(); ++i) encoded[i] = encode(clause[i]);
+		attachClause(encoded.data(), static_cast<int>(clause.size()), false);
+		return;
+	}
 
+	int size = static_cast<int>(clause.size());
+	if (size <= 2) {
+		int encoded[2];
+		for (int i = 0; i < size; ++i) encoded[i] = encode(clause[i]);
+		loadClause(encoded, size);
+	}
+	else {
+		int clauseNumber = clauses.allocate(size);
+		auto stored = clauses[clauseNumber];
+		stored.setId(++lastId);
+		for (int i = 0; i < size; ++i) stored[i] = encode(clause[i]);
+		watchClause(clauseNumber);
+	}
+}
+
+// Ensure variable objects exist for every variable up to and including 'count'.
+// Variables which arrive after loading go straight into the heap.
+void Solver::addVariables(int count) {
+
+	int first = static_cast<int>(variables.size());
+	if (first <= count) variables.resize(static_cast<size_t>(count) + 1);
+	activity.resize(variables.size());
+	unitIds.resize(variables.size(), 0);
+
+	int size = static_cast<int>(variables.size());
+	if (loaded && first < size) {
+		n = size - 1;
+		bimp.grow(2 * (n + 1));
+		for (int v = first; v <= n; ++v) heap.push(v);
+	}
+}
+
+// Add one encoded clause to the problem. Its variables must already exist.
+void Solver::loadClause(const int* encoded, int size) {
+
+	int id = ++lastId;
+
+	// Add the clause to our collection of clauses. Stored encoded via "2k/2k+1" scheme.
+	switch (size) {
+
+		// Empty clauses mean there is no solution.
+		case 0:
+			solutionFailed = true;
+			break;
+
+		// Unit clauses go strait to trail if no contradiction found, otherwise fail.
+		// Watch lists are not set for unit clauses.
+		case 1: {
+			auto literal = encoded[0];
+			auto variable = vfl(literal);
+
+			// Mismatch if not free and polarity does not match.
+			bool contradiction = variable.isFree() ? false : (variable.getValue() + literal) & 1;
+
+			// Place literal on trail if it is not a mismatch.
+			if (contradiction) {
+				solutionFailed = true;
+				proofEmpty(encoded, 1, id);
 			}
-			// Standard clause of length greater than 1. 
-			default:
-				auto clauseNumber = clauses.size();
-				clauses.emplace_back(Clause(encoded));
-				clauses.back().setClauseNumber(clauseNumber);
-				auto l0 = clauses.back().getLiterals()[0];
-				auto l1 = clauses.back().getLiterals()[1];
-				auto& v0 = vfl(l0);
-				auto& v1 = vfl(l1);
-				v0.addToWatch(clauseNumber, l0 % 2 == 0);
-				v1.addToWatch(clauseNumber, l1 % 2 == 0);
-		}
+			else if (variable.isFree()) {
+				// Add the literal to trail. No reason for unit clauses.
+				addForcedLiteralToTrail(literal, 0);
+				unitIds[literal >> 1] = id;
+			}
+			break; }
+
+		// Binary clauses go into the bimp table.
+		case 2:
+			bimp.addClause(encoded[0], encoded[1], id);
+			break;
+
+		// Standard clause of length greater than 2. 
+		default: {
+			int clauseNumber = clauses.add(encoded, size);
+			clauses[clauseNumber].setId(id);
+			watchClause(clauseNumber); }
 	}
+}
+
+// Watch the first two literals of a clause in the arena.
+void Solver::watchClause(int clauseNumber) {
+	auto clause = clauses[clauseNumber];
+	auto l0 = clause[0];
+	auto l1 = clause[1];
+	vfl(l0).addToWatch(clauseNumber, l1, l0 % 2 == 0);
+	vfl(l1).addToWatch(clauseNumber, l0, l1 % 2 == 0);
+}
 
-	// Record the index for the end of the clause vector.
-	minl = static_cast<int>(clauses.size());
+// Everything has been loaded. Prepare the bimp table and the heap.
+void Solver::finishLoading() {
+
+	if (preprocessing && !proof && !solutionFailed) preprocess();
+	loaded = true;
+
+	// Record the reference the first learned clause will receive.
+	minl = clauses.nextReference();
 
 	// Record the number of variables in the problem.
 	n = variables.size() - 1;
 	E = trail.size();
 
-	/*
-	std::cout << "Number of variables: " << n << "\n";
-	std::cout << "Number of clauses: " << clauses.size() - 1 + trail.size() << "\n";
-	std::cout << "Number of unit clauses: " << trail.size() << "\n";
-	*/
+	// Pack the binary implications now that every literal is known.
+	bimp.pack(2 * (n + 1));
 
 	// Add free variables to heap.
-	std::vector<Variable*> shuffledVariablePointers;
-	for (int i = 1; i < variables.size(); ++i) shuffledVariablePointers.emplace_back(&variables[i]);
-
-	// Get our random generator seed. Use supplied argument if provided, else generate a random seed.
-	int seed;
-	if (seedArgument < 0) seed = std::chrono::system_clock::now().time_since_epoch().count();
-	else seed = seedArgument;
+	heap.setVariables(&variables);
+	heap.setActivities(&activity);
+	std::vector<int> shuffledVariables;
+	shuffledVariables.reserve(n);
+	for (int i = 1; i <= n; ++i) shuffledVariables.emplace_back(i);
 
 	// Give seed to heap as well.
 	heap.setSeed(seed);
 
 	// Shuffle the variables to add to the heap. This prevents getting stuck in "ruts" if invoked multiple times.
-	std::shuffle(shuffledVariablePointers.begin(), shuffledVariablePointers.end(), std::default_random_engine(seed));
-	for (auto &v : shuffledVariablePointers) {
-		if (v->isFree()) heap.push(v);
+	std::shuffle(shuffledVariables.begin(), shuffledVariables.end(), std::default_random_engine(seed));
+	for (auto v : shuffledVariables) {
+		if (vfv(v).isFree() && !(preprocessor && preprocessor->isEliminated(v))) heap.push(v);
 	}
 }
 
-// Entry point to begin solving the CNF supplied to the constructor.
-std::vector<bool> Solver::Solve() {
+// Gather the problem as loaded so far, simplify it, and load the result from
+// scratch. Units sit on the trail, binary clauses are still staged in the bimp
+// table, and the longer ones fill the arena.
+void Solver::preprocess() {
+
+	Formula formula;
+	formula.variables = static_cast<int>(variables.size()) - 1;
+	for (int literal : trail) {
+		formula.literals.push_back(literal);
+		formula.literals.push_back(0);
+		formula.clauses++;
+	}
+	auto binaries = bimp.stagedClauses();
+	for (size_t i = 0; i < binaries.size(); i += 2) {
+		formula.literals.insert(formula.literals.end(), { binaries[i], binaries[i + 1], 0 });
+		formula.clauses++;
+	}
+	for (int c = Clause::headerSize; c < clauses.size(); c = clauses.next(c)) {
+		auto clause = clauses[c];
+		for (int i = 0, len = clause.size(); i < len; ++i) formula.literals.push_back(clause[i]);
+		formula.literals.push_back(0);
+		formula.clauses++;
+	}
+
+	preprocessor = std::make_unique<Preprocessor>(formula, frozen);
+	preprocessor->run();
+	eliminatedCount = preprocessor->getEliminatedCount();
+
+	clauses = ClauseArena();
+	bimp = BimpTable();
+	trail.clear();
+	G = 0;
+	variables.clear();
+	variables.resize(1);
+	activity.clear();
+	addVariables(formula.variables);
+
+	auto& simplified = preprocessor->getFormula();
+	for (size_t i = 0, len = simplified.literals.size(); i < len; ++i) {
+		size_t start = i;
+		while (simplified.literals[i] != 0) ++i;
+		loadClause(simplified.literals.data() + start, static_cast<int>(i - start));
+	}
+
+	// Nothing to extend.
+	if (eliminatedCount == 0) preprocessor.reset();
+}
+
+// Put back every clause preprocessing removed, at level 0. The eliminated
+// variables join the search again and the preprocessor is no longer needed.
+void Solver::restoreEliminated() {
+
+	if (depth() > 0) backjump(0);
+
+	auto removed = preprocessor->getRemovedClauses();
+	for (size_t i = 0, len = removed.size(); i < len; ++i) {
+		size_t start = i;
+		while (removed[i] != 0) ++i;
+		attachClause(removed.data() + start, static_cast<int>(i - start), false);
+	}
+
+	for (int v = 1; v <= n; ++v) {
+		if (preprocessor->isEliminated(v) && vfv(v).isFree() && vfv(v).getHloc() < 0) heap.push(v);
+	}
+	eliminatedCount = 0;
+	preprocessor.reset();
+}
+
+void Solver::freeze(int variable) {
+	if (static_cast<int>(frozen.size()) <= variable) frozen.resize(static_cast<size_t>(variable) + 1, false);
+	frozen[variable] = true;
+	if (preprocessor && preprocessor->isEliminated(variable)) restoreEliminated();
+}
+
+// Entry point to begin solving the clauses supplied so far. The first element
+// of the result tells whether a solution was found; an empty result means the
+// search was cancelled through the stop flag.
+std::vector<bool> Solver::Solve() { return Solve(std::span<const int>()); }
+
+// Solve may be called repeatedly. Each call starts again from level 0 with
+// the learned clauses, activities and saved phases of the calls before it.
+std::vector<bool> Solver::Solve(std::span<const int> assumed) {
+
+	assumptions.clear();
+	for (int a : assumed) assumptions.push_back(2 * std::abs(a) + (a < 0));
+	failedAssumptions.clear();
+
+	// Assumed variables must survive preprocessing.
+	for (int a : assumptions) freeze(a >> 1);
+	if (!loaded) finishLoading();
+	addVariables(assumptions.empty() ? 0 : (*std::max_element(assumptions.begin(), assumptions.end()) >> 1));
+
+	// An empty clause or contradictory unit clauses were supplied.
+	if (solutionFailed) return reportFailure();
+
+	// A previous call may have stopped anywhere, even in the middle of a full run.
+	if (depth() > 0) backjump(0);
+	fullRun = false;
 
 	while (true){
 
@@ -143,23 +350,39 @@ std::vector<bool> Solver::Solve() {
 		// F == G ? 
 		if (G == trail.size()) {
 
+			// The first levels each hold one assumption. A level is still opened
+			// for an assumption which is already true, leaving it empty.
+			if (depth() < static_cast<int>(assumptions.size())) {
+				int a = assumptions[depth()];
+				auto v = vfl(a);
+				if (v.isFalse(a)) {
+					analyzeFinal(a);
+					return reportFailure();
+				}
+				beginLevel();
+				if (v.isFree()) addForcedLiteralToTrail(a, 0);
+				continue;
+			}
+
 
 			// If we are finished. I.e the number of variables on the trail
-			// is equal to the number of variables in the problem.
-			if (trail.size() == n) {
+			// is equal to the number of variables in the problem, less those
+			// which preprocessing eliminated.
+			if (static_cast<int>(trail.size()) + eliminatedCount == n) {
 				
 				// If we're doing a full run, check if we actually encountered any conflicts.
-				int max = 0;
-				if (fullRun) max = static_cast<int>(*std::max_element(conflicts.begin(), conflicts.end()));
+				// Binary conflicts are recorded as negative entries.
+				bool conflicted = fullRun && std::any_of(conflicts.begin(), conflicts.end(), [](int c) { return c != 0; });
 
 				// If not a full run we genuinely solved the problem.
 				// Or if it's a full run but we did not encounter any conflicts.
-				if (!fullRun || ( fullRun && (max == 0))) {
+				if (!conflicted) {
 
 					// Construct and return boolean vector.
 					std::vector<bool> solution(n + 1);
 					solution.front() = true;
 					for (auto t : trail) solution[t >> 1] = t & 1 ? false : true;
+					if (preprocessor) preprocessor->extend(solution);
 					return solution;
 				}
 				// Otherwise we "succeeded" because we ignored conflicts for a full run.
@@ -173,15 +396,38 @@ std::vector<bool> Solver::Solve() {
 			}
 			// Check if it's time to get rid of useless learned clauses.
 			else if (!fullRun && totalLearnedClauses > purgeThreshold) {
+				if (reduction == ReductionMode::Activity) {
+					purgeProcessing();
+					continue;
+				}
 				fullRun = true;
 				//std::cout << "Learned " << numberLearnedClauses << ". Full run starting\n";
 				for (auto& c : conflicts) c = 0;
 			}
-			// Is it time to flush literals?
-			else if (totalLearnedClauses >= flushThreshold) {
+			// A purge has earned probing and vivification passes. They leave the
+			// search to start again from level 0.
+			else if (!fullRun && (probeBudget > 0 || vivifyBudget > 0)) {
+				probeProcessing();
+				if (!solutionFailed) vivifyProcessing();
+				if (solutionFailed) return reportFailure();
+				continue;
+			}
+			// Is it time to restart? Not during a full run, whose recorded
+			// conflicts would be left pointing at levels that no longer exist.
+			else if (!fullRun && restartPolicy->due(agility)) {
 				flushProcessing();
 			}
 
+			// Another thread may have asked us to stop.
+			if (stopFlag != nullptr && stopFlag->load(std::memory_order_relaxed)) return std::vector<bool>();
+
+			// Take in clauses learned by other solvers. Full runs are left alone
+			// since they depend on the levels they have recorded conflicts for.
+			if (exchange != nullptr && !fullRun && importClauses()) {
+				if (solutionFailed) return reportFailure();
+				continue;
+			}
+
 			// Not finished. We need to make a decision.
 			// Select a free variable from the heap and place on trail.
 			// Will result in F = G + 1. i.e. will increment F.
@@ -196,7 +442,7 @@ std::vector<bool> Solver::Solve() {
 		do {
 			auto literal = trail[G++];
 			conflictEncountered = checkForcing(literal);
-			if (conflictEncountered && solutionFailed) return std::vector<bool>{false};
+			if (conflictEncountered && solutionFailed) return reportFailure();
 		} while (conflictEncountered);
 	}
 
@@ -224,143 +470,151 @@ bool Solver::checkForcing(int literal) {
 #endif
 
 	// Get the variable object corresponding to the literal.
-	auto& variable = vfl(literal);
+	auto variable = vfl(literal);
 
 	// Get the complement of the literal. 
 	int contradictedLiteral = literal ^ 1;
 
-	// Get indices of each clause which watches the contradicted polarity of the literal.
+	// Get each watch on a clause which watches the contradicted polarity of the literal.
+	// The list is rewritten in place: 'i' reads the next watch and 'j' writes the
+	// watches which stay. Watches which move to another literal are simply not written back.
 	auto& contradictedWatchers = variable.getContradictedWatchers();
+	Watch* i = contradictedWatchers.data();
+	Watch* j = i;
+	Watch* end = i + contradictedWatchers.size();
 
-	// Create a copy to iterate through. This is so we don't modify the same collection we are iterating through.
-	std::vector<int> contradictedWatcherIndicesToProcess(contradictedWatchers.begin(), contradictedWatchers.end());
+	while (i != end) {
 
-	// Inspect each contradicted clause. Below we remove any if necessary from variable's collection.
-	for (auto contradictedClauseNumber : contradictedWatcherIndicesToProcess){
+		Watch watch = *i++;
 
-		// Using the clause index, get the clause object which contains the contradicted literal.
-		auto& contradictedClause = clauses[contradictedClauseNumber];
+		// If the cached blocker is true the clause is satisfied. Keep the
+		// watch without touching the clause at all.
+		if (variables.literalValue(watch.blocker) > 0) {
+			*j++ = watch;
+			continue;
+		}
 
-		// Get the literals which comprise this clause.
-		auto& contradictedClauseLiterals = contradictedClause.getLiterals();
+		// Using the clause reference, get a view of the clause which contains the contradicted literal.
+		int contradictedClauseNumber = watch.clause;
+		auto contradictedClause = clauses[contradictedClauseNumber];
+
+		// Get the literals which comprise this clause. They sit directly after the clause header.
+		int* contradictedClauseLiterals = contradictedClause.begin();
+		int contradictedClauseSize = contradictedClause.size();
 
 		// Algorithm C requires the literal at index 1 of the clause to be the contradicted literal.
 		// Swap first two literals if the element at index 1 is not the contradicted literal.
-		// This is a branchless swap which has proven to be a bit faster. 
-		//bool swap = contradictedClauseLiterals[1] != contradictedLiteral;
-		//std::iter_swap(contradictedClauseLiterals.begin(), contradictedClauseLiterals.begin() + swap);
 		if (contradictedClauseLiterals[1] != contradictedLiteral) std::swap(contradictedClauseLiterals[0], contradictedClauseLiterals[1]);
 
 #ifdef DEBUG
 		// Sanity check.
-		if (contradictedClauseLiterals.at(1) != contradictedLiteral) {
+		if (contradictedClauseLiterals[1] != contradictedLiteral) {
 			std::cout << "At this point l1 should be the complement of the selected literal.\n";
 		std::cout << "Contradicted clause number: " << contradictedClauseNumber << "\n";
-		std::cout << "Contradicted clause literals: ";
-			printVector(contradictedClauseLiterals);
 			std::cin.get();
 		}
 
 		std::cout << "Contradicted clause number: " << contradictedClauseNumber << "\n";
-		std::cout << "Contradicted clause literals: ";
-		printVector(contradictedClauseLiterals);
 #endif
 
 		// If literal at index 0 is not true (i.e. false or unset).
-		auto l0 = contradictedClauseLiterals.front();
-		auto& v0 = vfl(l0);
-
-		// If the first literal at index 0 is true, nothing must be done.
-		if (!v0.isTrue(l0)) {
-			
-			// We will try to swap the literal at index 1 with another which is NOT FALSE.
-			bool swapSuccess = false;
-			for (size_t i = 2, n = contradictedClauseLiterals.size(); i < n; ++i) {
+		auto l0 = contradictedClauseLiterals[0];
+		auto v0 = vfl(l0);
 
-				// Get the candidate literal and its associated variable object.
-				auto lx = contradictedClauseLiterals[i];
-				auto& vx = vfl(lx);
+		// If the first literal at index 0 is true, nothing must be done
+		// except to remember it as the blocker for next time.
+		if (variables.literalValue(l0) > 0) {
+			*j++ = Watch{ contradictedClauseNumber, l0 };
+#ifdef DEBUG
+			std::cout << "l0 true, doing nothing.\n";
+#endif
+			continue;
+		}
 
-				// If the new variable has not been set false.
-				if (!vx.isFalse(lx)) {
+		// We will try to swap the literal at index 1 with another which is NOT FALSE.
+		// Only the assignment bytes are read; long clauses are scanned several literals at a time.
+		int k = findNonFalse(contradictedClauseLiterals, 2, contradictedClauseSize, variables.literalValues());
+		if (k < contradictedClauseSize) {
 
+			auto lx = contradictedClauseLiterals[k];
 #ifdef DEBUG
-					std::cout << "Swapping l1 with " << lx << "\n";
+			std::cout << "Swapping l1 with " << lx << "\n";
 #endif
 
-					// Swap elements, add clause to new watched variable, and remove from old variable's watch.
-					std::swap(contradictedClauseLiterals[1], contradictedClauseLiterals[i]);
-					vx.addToWatch(contradictedClauseNumber, !(lx & 1));
-					variable.removeFromWatch(contradictedClauseNumber, !(contradictedLiteral & 1));
-					swapSuccess = true;
-					break;
-				}
-			}
+			// Swap elements and add clause to new watched variable. The watch is
+			// dropped from this list by not writing it back.
+			std::swap(contradictedClauseLiterals[1], contradictedClauseLiterals[k]);
+			vfl(lx).addToWatch(contradictedClauseNumber, l0, !(lx & 1));
+			continue;
+		}
 
-			// If we could not swap with another variable, we must check literal at clause index 0.
-			// Our only hope is that it is free and can therefore be set true.
-			if (!swapSuccess) {
+		// The clause keeps watching the contradicted literal.
+		*j++ = Watch{ contradictedClauseNumber, l0 };
 
-				if (v0.isFree()) {
+		// If we could not swap with another variable, we must check literal at clause index 0.
+		// Our only hope is that it is free and can therefore be set true. Its bimp
+		// implications are examined when it is reached on the trail.
+		if (v0.isFree()) {
 #ifdef DEBUG
-					std::cout << "Could not swap. Adding " << l0 << " to trail.\n";
+			std::cout << "Could not swap. Adding " << l0 << " to trail.\n";
 #endif
-					addForcedLiteralToTrail(l0, contradictedClauseNumber);
-
-					// We placed a literal on the trail. See if that causes conflicting
-					// propagations via the bimp table. 
-					bool conflict = bimpProcessing(l0);
-					if (conflict) return true;
-				}
-				// We must resolve a conflict.
-				else {
+			addForcedLiteralToTrail(l0, contradictedClauseNumber);
+		}
+		// We must resolve a conflict.
+		else {
 #ifdef DEBUG
-					std::cout << "Could not swap. Resolving conflict.\n";
+			std::cout << "Could not swap. Resolving conflict.\n";
 #endif
-					// If there have been no decision levels created, we failed.
-					if (depth() == 0) {
-						solutionFailed = true;
-						return true;
-					}
-					// We resolve conflicts if we are not at level 0 and not doing a full run.
-					else if (!fullRun) {
-
-						conflictProcessing(contradictedClauseLiterals);
-
-						return true;
-					}
-					// On full runs we just ignore the conflict and move on.
-					else {
-						// Record first conflict for this level.
-						int d = depth();
-						if (conflicts[d] == 0) conflicts[d] = contradictedClauseNumber;
-					}
+			// Unless we're ignoring conflicts, close the list before conflict
+			// processing installs new watches.
+			if (depth() == 0 || !fullRun) {
+				while (i != end) *j++ = *i++;
+				contradictedWatchers.resize(j - contradictedWatchers.data());
+			}
 
-				}
+			// If there have been no decision levels created, we failed.
+			if (depth() == 0) {
+				solutionFailed = true;
+				proofEmpty(contradictedClauseLiterals, contradictedClauseSize, contradictedClause.getId());
+				return true;
+			}
+			// Lookahead only wants to know about the conflict.
+			else if (probing) {
+				probeConflict = contradictedClauseNumber;
+				return true;
+			}
+			// We resolve conflicts if we are not at level 0 and not doing a full run.
+			else if (!fullRun) {
+				conflictProcessing(contradictedClauseLiterals, contradictedClauseSize, contradictedClause.getId());
+				return true;
+			}
+			// On full runs we just ignore the conflict and move on.
+			else {
+				// Record first conflict for this level.
+				int d = depth();
+				if (conflicts[d] == 0) conflicts[d] = contradictedClauseNumber;
 			}
 		}
-#ifdef DEBUG
-		else
-		{
-			std::cout << "l0 true, doing nothing.\n";
-		}
-#endif
 	}
 
+	contradictedWatchers.resize(j - contradictedWatchers.data());
 	return false;
 }
 
-void Solver::conflictProcessing(std::vector<int>& conflictClause) {
+void Solver::conflictProcessing(const int* conflictClause, int size, int clauseId) {
 
 	// Learn a new clause and return the depth we must return to for installation.
-	int dprime = resolveConflict(conflictClause);
+	int dprime = resolveConflict(conflictClause, size);
+
+	// Shorten the learned clause for efficiency. Only literals at or below
+	// dprime are involved, so this can run before the backjump, while the
+	// proof can still see every reason which took part.
+	removeRedundantLiterals();
+	if (lrat) proofHints(conflictClause, size, clauseId);
 
 	// Remove literals from the trail.
 	backjump(dprime);
 
-	// Shorted the learned clause for efficiency.
-	removeRedundantLiterals();
-
 	// Install the new clause.
 	learn(dprime);
 
@@ -369,41 +623,132 @@ void Solver::conflictProcessing(std::vector<int>& conflictClause) {
 // Knuth step C6.
 void Solver::makeADecision() {
 
-	// Record trail index at which this level begins.
-	levels.emplace_back(trail.size());
-
-	// Should this be done here?
-	// Make sure there's a spot in LS for every level.
-	while (LS.size() <= depth()) pushLevelStamp(0); 
-
-	// Ensure we have a large enough conflicts vector.
-	// Will be zeroed at the beginning of each full run.
-	while (conflicts.size() <= depth()) conflicts.emplace_back(0);
+	beginLevel();
 
 #ifdef DEBUG
 	std::cout << "########## " << "LEVEL " << depth() << " ###########\n";
 #endif
 
-	// Repair heap if necessary.
-	if (heapCorrupted) {
-		heap.reheapify();
-		heapCorrupted = false;
-	}
-
 	// Repeatedly pop a variable from the heap until we find one
 	// that is free.
-	Variable* nextFree = nullptr;
+	int nextFree;
 	do {
 		nextFree = heap.pop(true); // Get max element but allow for occassional random elements. 
-	} while (!(nextFree->isFree()));
+	} while (!vfv(nextFree).isFree());
 	
 	// Add the new decision variable to the trail.
 	// This will cause F = G + 1
-	addDecisionVariableToTrail(nextFree->getVariableNumber());
+	addDecisionVariableToTrail(nextFree);
+}
+
+void Solver::beginLevel() {
+
+	// Record trail index at which this level begins.
+	levels.emplace_back(trail.size());
+
+	// Should this be done here?
+	// Make sure there's a spot in LS for every level.
+	while (static_cast<int>(LS.size()) <= depth()) pushLevelStamp(0); 
+
+	// Ensure we have a large enough conflicts vector.
+	// Will be zeroed at the beginning of each full run.
+	while (static_cast<int>(conflicts.size()) <= depth()) conflicts.emplace_back(0);
+	while (static_cast<int>(binaryConflicts.size()) <= depth()) binaryConflicts.emplace_back(0);
+}
+
+// Process the trail from G onward without resolving conflicts.
+bool Solver::propagate() {
+
+	if (!loaded) finishLoading();
+	if (solutionFailed) return false;
+
+	probing = true;
+	bool conflict = false;
+	while (!conflict && G < static_cast<int>(trail.size())) conflict = checkForcing(trail[G++]);
+	probing = false;
+
+	return !conflict;
+}
+
+bool Solver::openLevel(int literal) {
+	if (!loaded) finishLoading();
+	beginLevel();
+	return imply(literal);
+}
+
+void Solver::closeLevel() { backjump(depth() - 1); }
+
+const std::vector<int>& Solver::getFailedAssumptions() const { return failedAssumptions; }
+
+// Follow reasons back from the complement of 'literal' to the assumptions it
+// rests on. Assumptions are the only decisions below the first ordinary
+// decision, so every literal without a reason above level 0 is one of them.
+void Solver::analyzeFinal(int literal) {
+
+	auto decode = [](int l) { return (l & 1) ? -(l >> 1) : (l >> 1); };
+
+	failedAssumptions.push_back(decode(literal));
+	auto v0 = vfl(literal);
+	if ((v0.getValue() >> 1) == 0) return;
+
+	incrementStamp();
+	v0.setStamp(stamp);
+
+	auto mark = [&](int l) {
+		auto v = vfl(l);
+		if ((v.getValue() >> 1) > 0) v.setStamp(stamp);
+	};
+
+	for (int t = v0.getTloc(); t >= levels[1]; --t) {
+
+		auto v = vfl(trail[t]);
+		if (v.getStamp() != stamp) continue;
+
+		int reason = v.getReason();
+		if (reason == 0) failedAssumptions.push_back(decode(trail[t]));
+		else if (reason > 0) {
+			auto reasonClause = clauses[reason];
+			for (int i = 1, len = reasonClause.size(); i < len; ++i) mark(reasonClause[i]);
+		}
+		else mark(-reason);
+	}
 }
 
+bool Solver::imply(int literal) {
+
+	int l = 2 * std::abs(literal) + (literal < 0);
+	auto v = vfl(l);
+	if (v.isTrue(l)) return true;
+	if (v.isFalse(l)) {
+		if (depth() == 0) solutionFailed = true;
+		return false;
+	}
+
+	addForcedLiteralToTrail(l, 0);
+	return propagate();
+}
+
+int Solver::probe(int literal) {
+	bool consistent = openLevel(literal);
+	int count = static_cast<int>(trail.size()) - levels.back();
+	closeLevel();
+	return consistent ? count : -1;
+}
+
+bool Solver::isFree(int variable) { return vfv(variable).isFree() && !(preprocessor && preprocessor->isEliminated(variable)); }
+
+int Solver::getVariableCount() { return static_cast<int>(variables.size()) - 1; }
+
+uint64_t Solver::getConflictCount() const { return conflictCount; }
+
+uint64_t Solver::getPropagationCount() const { return propagations; }
+
+int Solver::getPurgeCount() const { return purgeCount; }
+
 // Construct a new clause.
-int Solver::resolveConflict(const std::vector<int>& clause, int d) {
+int Solver::resolveConflict(const int* clause, int size, int d) {
+
+	conflictCount++;
 	
 #ifdef DEBUG
 	std::cout << "Trail: ";
@@ -427,36 +772,37 @@ int Solver::resolveConflict(const std::vector<int>& clause, int d) {
 	b.emplace_back(-1);
 	incrementStamp();
 	int dprime = 0;
-	int learnCount = clauses.size() - minl;
 
 	// Process the first literal in the clause.
-	auto l0 = clause.front();
-	auto& v0 = vfl(l0);
+	auto l0 = clause[0];
+	auto v0 = vfl(l0);
 	v0.setStamp(stamp); // Stamped here, not in 'blit' so count is not affected. 
+	// Unless only the learned clause is to be bumped, every variable met here is.
+	bool bumpResolved = bumpTarget == BumpTarget::Resolved;
 	bool rescale = false;
-	rescale |= v0.bumpActivity(DEL);
-	heapCorrupted = true; // !! This makes a huge improvement. Heap corruption is a serious issue. 
+	if (bumpResolved) rescale |= bumpActivity(v0);
 
 	// If depth was specified use that depth, otherwise get it from level vector size.
 	int currentDepth = d < 0 ? depth() : d;
 
-	// Do we need to zero the LS array before blit runs? !!!!!!!!!!!!!!!!!!!!!!!!!!
-	for (auto& x : LS) x = 0;
+	// Levels marked by earlier conflicts hold older stamps, so LS needs no clearing.
+	// Clause activity is bumped by the same amount for every reason.
+	double clauseBump = std::pow(clauseRho, -totalLearnedClauses);
 
 	// Local function to process 'b' literals.
 	auto blit = [&](int literal) {
 
-		auto& v = vfl(literal);
+		auto v = vfl(literal);
 		if (v.getStamp() != stamp) {
 			v.setStamp(stamp);
 			auto p = (v.getValue() >> 1);
 			if (p > 0) {
-				rescale |= v.bumpActivity(DEL); // Anytime we bump activity we may corrupt heap. Reheapify before popping heap? Set corrupted flag?
+				if (bumpResolved) rescale |= bumpActivity(v);
 				count += (p == currentDepth);
 				if (p < currentDepth) {
 					b.emplace_back(v.getCurrentLiteralValue() ^ 1);
 					dprime = std::max(p, dprime);
-					int levelStamp = getLevelStamp(p);
+					size_t levelStamp = getLevelStamp(p);
 					if (levelStamp <= stamp) setLevelStamp(p, stamp + (levelStamp == stamp));
 				}
 			}
@@ -464,13 +810,13 @@ int Solver::resolveConflict(const std::vector<int>& clause, int d) {
 	};
 
 	// Apply blit algorithm to all literals at index GREATER THAN 0 in clause.
-	for (size_t i = 1, len = clause.size(); i < len; ++i) blit(clause[i]);
+	for (int i = 1; i < size; ++i) blit(clause[i]);
 
 
 	// Get the highest trail index of ALL literals in the clause.
 	int t = 0;
-	for (auto lit : clause) {
-		auto& v = vfl(lit);
+	for (int i = 0; i < size; ++i) {
+		auto v = vfl(clause[i]);
 		t = std::max(v.getTloc(), t); // Am I using 'max' correctly?
 	}
 
@@ -480,7 +826,7 @@ int Solver::resolveConflict(const std::vector<int>& clause, int d) {
 
 	while (count > 0) {
 		auto l = trail[t--]; // Get literal furthest up the trail.
-		auto& v = vfl(l);
+		auto v = vfl(l);
 		if (v.getStamp() == stamp) {
 
 			count--;
@@ -490,13 +836,13 @@ int Solver::resolveConflict(const std::vector<int>& clause, int d) {
 			if (reasonIndex > 0) {
 
 				// This clause is participating in a resolution. Increase its activity. !!!!! NOT ENTIRELY SURE WHERE TO PUT THIS.
-				auto clauseActivity = clauses[reasonIndex].getActivity();
-				//clauses.at(reasonIndex).setActivity(clauseActivity + std::pow(clauseRho, -learnCount));
-				clauses[reasonIndex].setActivity(clauseActivity + std::pow(clauseRho, -totalLearnedClauses)); // So far no difference. Check on larger problems?
+				auto reasonClause = clauses[reasonIndex];
+				auto clauseActivity = reasonClause.getActivity();
+				reasonClause.setActivity(clauseActivity + clauseBump); // So far no difference. Check on larger problems?
+				reasonClause.setUsed(true);
 
 				// Blit literals at index greater than 0.
-				auto& reasonClause = clauses[reasonIndex].getLiterals();
-				for (size_t i = 1, len = reasonClause.size(); i < len; ++i) blit(reasonClause[i]);
+				for (int i = 1, len = reasonClause.size(); i < len; ++i) blit(reasonClause[i]);
 			}
 			else if (reasonIndex < 0) {
 				blit(-reasonIndex);
@@ -504,18 +850,9 @@ int Solver::resolveConflict(const std::vector<int>& clause, int d) {
 		}
 	}
 
-	// If any variable had its activity score exceed our given threshold, rescale
-	// all variables by that threshold. 
-	if (rescale) {
-		for (size_t i = 1, len = variables.size(); i < len; ++i) {
-			auto &variable = variables[i];
-			auto currentActivity = variable.getActivity();
-			variable.setActivity(currentActivity / variable.threshold);
-		}
-
-		// Rescale DEL too.
-		DEL /= variables.front().threshold;
-	}
+	// If any variable had its activity score exceed the limit, rescale them all.
+	// The heap stays in order.
+	if (rescale) activity.rescale();
 
 #ifdef DEBUG
 	// dprime is where we will jump back to. It needs to be less than current depth.
@@ -565,7 +902,7 @@ void Solver::removeRedundantLiterals() {
 
 		int bi = clause[i];
 		int level = vfl(bi).getValue() >> 1;
-		int levelStamp = getLevelStamp(level);
+		size_t levelStamp = getLevelStamp(level);
 
 		// Redundant.                        bi or bi ^ 1 ? 
 		if (levelStamp == (stamp + 1) && red(bi, stamp)) {
@@ -582,52 +919,78 @@ void Solver::removeRedundantLiterals() {
 	}
 }
 
+// Is 'lit' implied by literals of the learned clause through a chain of
+// reasons? The search runs on redStack rather than recursing. A literal shown
+// redundant is stamped stamp + 1 and one shown not to be stamp + 2, so no
+// literal is examined twice in one conflict. Only literals on levels which
+// the clause touches (level stamp at least 'stamp') can be redundant.
 bool Solver::red(int lit, size_t stamp){
 
-	auto& v0 = vfl(lit);
-
 	// If l is a decision literal, return false.
-	int reasonIndex = v0.getReason();
-	if (reasonIndex == 0) return false;
-
-	// Get the literals which comprise the clause.
-	// Note the dummy "0" when the reason index is negative. This is to keep the vector length 2 for the for loop.
-	auto reasonLiterals = (reasonIndex > 0) ? clauses[reasonIndex].getLiterals() : std::vector<int>{0, -reasonIndex}; // Had to ditch reference &. Fix this for performance?
-
-	// Iterate through all elements except the first.
-	for (size_t i = 1, len = reasonLiterals.size(); i < len; ++i) {
+	if (vfl(lit).getReason() == 0) return false;
+
+	redStack.clear();
+	redStack.emplace_back(lit, 1);
+	while (!redStack.empty()) {
+
+		int l0 = redStack.back().first;
+		int reasonIndex = vfl(l0).getReason();
+
+		// Get the literals which comprise the reason. Binary reasons are not stored in the arena;
+		// the dummy "0" keeps the implying literal at index 1.
+		int binaryReason[2] = { 0, -reasonIndex };
+		const int* reasonLiterals = binaryReason;
+		int len = 2;
+		if (reasonIndex > 0) {
+			auto reasonClause = clauses[reasonIndex];
+			reasonLiterals = reasonClause.begin();
+			len = reasonClause.size();
+		}
 
-		int l = reasonLiterals[i];
-		auto& v = vfl(l);
-		int level = v.getValue() >> 1;
-		if (level > 0) {
+		// Look for a literal not yet known to be implied. Level 0 literals always are.
+		bool descend = false;
+		while (redStack.back().second < len) {
+
+			int l = reasonLiterals[redStack.back().second++];
+			auto v = vfl(l);
+			int level = v.getValue() >> 1;
+			if (level == 0) continue;
+
+			size_t vstamp = v.getStamp();
+			bool failed = vstamp == stamp + 2;
+			if (!failed && vstamp < stamp) {
+				if (getLevelStamp(level) < stamp || v.getReason() == 0) {
+					v.setStamp(stamp + 2);
+					failed = true;
+				}
+				else {
+					redStack.emplace_back(l, 1);
+					descend = true;
+					break;
+				}
+			}
 
-			int vstamp = v.getStamp();
-			if (vstamp == (stamp + 2)) return false;                       // l or l^ 1 ?
-			else if (vstamp < stamp && ((getLevelStamp(level) < stamp) || !red(l, stamp))) {
-				v.setStamp(stamp + 2);
+			// Every literal whose proof depended on this one fails with it. The
+			// literal the search started from is in the learned clause and keeps its stamp.
+			if (failed) {
+				for (size_t i = 1; i < redStack.size(); ++i) vfl(redStack[i].first).setStamp(stamp + 2);
 				return false;
 			}
-			else {
-				//v0.setStamp(stamp + 1);
-				//return true;
-			}
 		}
+		if (descend) continue;
 
-		//v0.setStamp(stamp + 1);
-		//return true;
+		vfl(l0).setStamp(stamp + 1);
+		redStack.pop_back();
 	}
 
-	v0.setStamp(stamp + 1);
 	return true;
 }
 
+size_t Solver::getLevelStamp(int index) { return LS[index]; }
 
-int Solver::getLevelStamp(int index) { return LS[index]; }
+void Solver::setLevelStamp(int index, size_t value) { LS[index] = value; }
 
-void Solver::setLevelStamp(int index, int value) { LS[index] = value; }
-
-void Solver::pushLevelStamp(int value) { LS.emplace_back(value); }
+void Solver::pushLevelStamp(size_t value) { LS.emplace_back(value); }
 
 void Solver::popLevelStamp() { LS.pop_back(); }
 
@@ -647,13 +1010,13 @@ void Solver::backjump(int dprime) {
 	while (trail.size() > target) {
 		auto lit = trail.back();    // Get last element from trail.
 		trail.pop_back();			// Remove from trail.
-		auto& v = vfl(lit);			// Get variable object.
+		auto v = vfl(lit);			// Get variable object.
 		v.setOval(v.getValue());	// Set old value to current.
-		v.setValue(-1);				// Reset value.
+		v.unassign();				// Reset value.
 		v.setTloc(-1);				// Reset trail location !!! Did not see in step C8!
 		if (v.getReason() > 0) clauses[v.getReason()].setReasonFor(-1);
 		v.setReason(0);			// Reset reason clause.
-		if (!v.getHloc()) heap.push(&v); // Place on heap if not already there.
+		if (v.getHloc() < 0) heap.push(v.getVariableNumber()); // Place on heap if not already there.
 	}
 
 	G = trail.size(); // G now points to the next literal to be placed on the trail. 
@@ -681,10 +1044,19 @@ void Solver::backjump(int dprime) {
 void Solver::learn(int dprime) {
 
 	totalLearnedClauses++;
+	int lbd = literalBlockDistance();
+	restartPolicy->learned(lbd);
 
 	// Access learned clause from member variable 'b'.
 	auto& clause = b;
 
+	if (exchange != nullptr) exportClause();
+
+	// Minimization only drops literals whose reasons are already implied by the
+	// rest, so the minimized clause is itself a RUP step and nothing else needs logging.
+	int id = ++lastId;
+	if (proof) proof->add(id, clause.data(), static_cast<int>(clause.size()), hints);
+
 	// Not unit clause - Install the clause.
 	if (dprime) {
 
@@ -693,7 +1065,7 @@ void Solver::learn(int dprime) {
 		// Ensure we are watching literals defined on level d.
 		bool found = false;
 		for (size_t i = 1, len = clause.size(); i < len; ++i) {
-			auto& v = vfl(clause[i]);
+			auto v = vfl(clause[i]);
 			auto level = v.getValue() >> 1;
 			if (level == dprime) {
 				found = true;
@@ -702,20 +1074,29 @@ void Solver::learn(int dprime) {
 			}
 		}
 
-		int clauseNumber = clauses.size();
-		clauses.emplace_back(clause);
-		clauses.back().setClauseNumber(clauseNumber);
-		addForcedLiteralToTrail(l0 , clauseNumber);
+		// Binary clauses go into the bimp table rather than the arena. They are never
+		// watched or purged. l1 is false, so its complement is the reason for l0.
+		if (clause.size() == 2) {
+			bimp.addClause(l0, clause[1], id);
+			addForcedLiteralToTrail(l0, -(clause[1] ^ 1));
+		}
+		else {
+			int clauseNumber = clauses.add(clause.data(), static_cast<int>(clause.size()));
+			clauses[clauseNumber].setLearned(true);
+			clauses[clauseNumber].setLbd(lbd);
+			clauses[clauseNumber].setActivity(std::pow(clauseRho, -totalLearnedClauses));
+			clauses[clauseNumber].setId(id);
+			addForcedLiteralToTrail(l0 , clauseNumber);
 
-		if (found) {
 			// Set the watches for the new clause. 
-			auto& v0 = vfl(l0);
-			v0.addToWatch(clauseNumber, (l0 % 2) == 0);
+			auto v0 = vfl(l0);
 			int l1 = clause[1];
-			auto& v1 = vfl(l1);
-			v1.addToWatch(clauseNumber, (l1 % 2) == 0);
+			v0.addToWatch(clauseNumber, l1, (l0 % 2) == 0);
+			auto v1 = vfl(l1);
+			v1.addToWatch(clauseNumber, l0, (l1 % 2) == 0);
 		}
-		else {
+
+		if (!found) {
 			std::cout << "No literal found on level d to watch!\n";
 			std::cin.get();
 			exit(1);
@@ -735,6 +1116,7 @@ void Solver::learn(int dprime) {
 
 		// Add unit clause to trail. Unit clauses do not have reasons.
 		addForcedLiteralToTrail(clause.front(), 0);
+		unitIds[clause.front() >> 1] = id;
 
 #ifdef DEBUG
 		if (clause.size() != 1) {
@@ -746,13 +1128,217 @@ void Solver::learn(int dprime) {
 
 	}
 
-	DEL /= rho;
+	// Bump the learned clause's variables if analysis didn't bump every variable it met.
+	if (bumpTarget == BumpTarget::Learned) {
+		bool rescale = false;
+		for (int literal : b) rescale |= bumpActivity(vfl(literal));
+		if (rescale) activity.rescale();
+	}
+	activity.decay();
+}
+
+// Offer the clause in 'b' to other solvers. It is scored before it is installed,
+// while its first literal is still free, so the range counts the levels of the rest.
+void Solver::exportClause() {
+
+	int size = static_cast<int>(b.size());
+	if (size > 2) {
+		if (size > shareSize) return;
+		incrementStamp();
+		if (rangeScore(b.data(), size, stamp) > shareRange) return;
+	}
+
+	exchange->publish(exchangeSource, b.data(), size);
+}
+
+// Bring in clauses published by other solvers, along with any which earlier
+// had to wait. Called only when every literal on the trail has been processed.
+bool Solver::importClauses() {
+
+	importBatch.clear();
+	importBatch.swap(pendingImports);
+	exchange->collect(exchangeSource, exchangeCursor, importBatch);
+
+	for (size_t start = 0, i = 0; i < importBatch.size(); ++i) {
+		if (importBatch[i] != 0) continue;
+
+		int* clause = importBatch.data() + start;
+		int size = static_cast<int>(i - start);
+		start = i + 1;
+
+		if (!attachClause(clause, size, true)) {
+			int* end = std::find(clause, clause + size, 0);
+			pendingImports.insert(pendingImports.end(), clause, end + 1);
+		}
+		if (solutionFailed) return true;
+	}
+
+	// Sharing is lossy anyway. Don't let clauses which never fit pile up.
+	if (pendingImports.size() > 4096) pendingImports.clear();
+
+	return G < static_cast<int>(trail.size());
+}
+
+// Install a clause after loading. Literals false at level 0 are dropped, and the
+// clause is rewritten in place, terminated by 0 if it shrank. Returns false if
+// the clause can't be installed at the current level and should be retried;
+// at level 0 that never happens.
+bool Solver::attachClause(int* clause, int size, bool learned) {
+
+	int k = 0;
+	for (int i = 0; i < size; ++i) {
+		int lit = clause[i];
+		auto v = vfl(lit);
+		if (!v.isFree() && (v.getValue() >> 1) == 0) {
+
+			// Satisfied for good.
+			if (v.isTrue(lit)) return true;
+			continue;
+		}
+		clause[k++] = lit;
+	}
+	if (k < size) clause[k] = 0;
+
+	int id = ++lastId;
+
+	// Every literal is false at level 0. The problem is unsatisfiable.
+	if (k == 0) {
+		solutionFailed = true;
+		proofEmpty(nullptr, 0, id);
+		return true;
+	}
+
+	// Units go on level 0. They are rare enough to be worth jumping back for.
+	if (k == 1) {
+		if (depth() > 0) backjump(0);
+		addForcedLiteralToTrail(clause[0], 0);
+		unitIds[clause[0] >> 1] = id;
+		return true;
+	}
+
+	// Watches and bimp implications assume a new clause has two literals which
+	// aren't false. Otherwise it would need propagating at some earlier level,
+	// so it waits until the solver has backed up far enough.
+	int w = 0;
+	for (int i = 0; i < k && w < 2; ++i) {
+		if (!vfl(clause[i]).isFalse(clause[i])) std::swap(clause[w++], clause[i]);
+	}
+	if (w < 2) return false;
+
+	if (k == 2) bimp.addClause(clause[0], clause[1], id);
+	else {
+		int clauseNumber = clauses.add(clause, k);
+		clauses[clauseNumber].setLearned(learned);
+		clauses[clauseNumber].setLbd(k);
+		clauses[clauseNumber].setId(id);
+		int l0 = clause[0];
+		int l1 = clause[1];
+		vfl(l0).addToWatch(clauseNumber, l1, (l0 % 2) == 0);
+		vfl(l1).addToWatch(clauseNumber, l0, (l1 % 2) == 0);
+	}
+
+	return true;
+}
+// Work out the LRAT hints for the clause in 'b', which was derived from the
+// conflict clause given. Every literal the conflict depends on is traced back
+// through its reasons until it reaches a literal of 'b' or level 0. Listing the
+// reasons in trail order lets a checker derive each of them by unit propagation.
+void Solver::proofHints(const int* clause, int size, int clauseId) {
+
+	incrementStamp();
+	for (int literal : b) vfl(literal).setStamp(stamp);
+
+	auto& pending = hintPending;
+	auto& involved = hintInvolved;
+	pending.assign(clause, clause + size);
+	involved.clear();
+	while (!pending.empty()) {
+
+		auto v = vfl(pending.back());
+		pending.pop_back();
+		if (v.getStamp() == stamp) continue;
+		v.setStamp(stamp);
+		involved.emplace_back(v.getVariableNumber());
+
+		// Level 0 literals are justified by their unit clauses.
+		if ((v.getValue() >> 1) == 0) continue;
+
+		int reason = v.getReason();
+		if (reason > 0) {
+			auto reasonClause = clauses[reason];
+			pending.insert(pending.end(), reasonClause.begin() + 1, reasonClause.end());
+		}
+		else if (reason < 0) pending.emplace_back(-reason);
+	}
+
+	std::sort(involved.begin(), involved.end(), [&](int x, int y) { return vfv(x).getTloc() < vfv(y).getTloc(); });
+
+	hints.clear();
+	for (int x : involved) {
+		auto v = vfv(x);
+		int id = (v.getValue() >> 1) == 0 ? unitIds[x] : reasonId(trail[v.getTloc()], v.getReason());
+		if (id != 0) hints.emplace_back(id);
+	}
+	if (clauseId != 0) hints.emplace_back(clauseId);
+}
+
+// Record a literal forced at level 0 as a unit clause, so later hints can name it.
+void Solver::proofUnit(int literal, int reason) {
+
+	hints.clear();
+	if (reason > 0) {
+		auto reasonClause = clauses[reason];
+		unitHints(reasonClause.begin() + 1, reasonClause.size() - 1);
+	}
+	else hints.emplace_back(unitIds[-reason >> 1]);
+	hints.emplace_back(reasonId(literal, reason));
+
+	int id = ++lastId;
+	proof->add(id, &literal, 1, hints);
+	unitIds[literal >> 1] = id;
+}
+
+// Every literal of the clause is false at level 0, so the empty clause follows.
+void Solver::proofEmpty(const int* clause, int size, int clauseId) {
+
+	if (!proof) return;
+
+	hints.clear();
+	if (lrat) {
+		unitHints(clause, size);
+		hints.emplace_back(clauseId);
+	}
+	proof->add(++lastId, nullptr, 0, hints);
+}
+
+// Append the unit clauses fixing each variable of the literals given. A clause
+// may repeat a literal, but a checker expects every hint to be used once.
+void Solver::unitHints(const int* literals, int size) {
+	incrementStamp();
+	for (int i = 0; i < size; ++i) {
+		auto v = vfl(literals[i]);
+		if (v.getStamp() == stamp) continue;
+		v.setStamp(stamp);
+		hints.emplace_back(unitIds[literals[i] >> 1]);
+	}
+}
+
+// Identifier of the clause which forced 'literal' for the given reason.
+int Solver::reasonId(int literal, int reason) {
+	if (reason > 0) return clauses[reason].getId();
+	return bimp.id(-reason, literal);
 }
+
+std::vector<bool> Solver::reportFailure() {
+	if (proof) proof->flush();
+	return std::vector<bool>{false};
+}
+
 // Add a variable to trail. The value is determined by the oval property. There is
 // no reason since it was a decision.
 void Solver::addDecisionVariableToTrail(int variableNumber) {
 
-	auto& variable = vfv(variableNumber);
+	auto variable = vfv(variableNumber);
 	if (variable.isFree()) {
 		variable.setValue(static_cast<int>(depth()));
 		agility = agility - (agility >> 13) + (((variable.getOval() - variable.getValue()) & 1) << 19);
@@ -774,7 +1360,7 @@ void Solver::addDecisionVariableToTrail(int variableNumber) {
 // The value is determined by the level and the literal value.
 void Solver::addForcedLiteralToTrail(int literal, int reason) {
 
-	auto& variable = vfl(literal);
+	auto variable = vfl(literal);
 	if (variable.isFree()) {
 		variable.setValue(static_cast<int>(depth()), literal);
 		agility = agility - (agility >> 13) + (((variable.getOval() - variable.getValue()) & 1) << 19);
@@ -782,9 +1368,13 @@ void Solver::addForcedLiteralToTrail(int literal, int reason) {
 		variable.setReason(reason);
 		trail.emplace_back(variable.getCurrentLiteralValue());
 		E = trail.size();
+		propagations++;
 
 		// Let the clause know it is the reason for a literal. 
 		if (reason > 0) clauses[reason].setReasonFor(variable.getVariableNumber());
+
+		// LRAT hints refer to level 0 literals through unit clauses.
+		if (lrat && reason != 0 && depth() == 0) proofUnit(literal, reason);
 	
 #ifdef DEBUG 
 
@@ -816,9 +1406,13 @@ void Solver::addForcedLiteralToTrail(int literal, int reason) {
 }
 
 
-// Convenience methods to get variable objects.
-Variable& Solver::vfl(int literal) { return variables[literal >> 1]; }
-Variable& Solver::vfv(int variableNumber) { return variables[variableNumber]; }
+// Bump a variable's activity and sift it up if it sits in the heap.
+// Returns true if the activities need rescaling.
+bool Solver::bumpActivity(Variable v) {
+	bool rescale = activity.bump(v.getVariableNumber());
+	heap.increase(v.getVariableNumber());
+	return rescale;
+}
 
 void Solver::incrementStamp() {
 	stamp += 3;
@@ -830,12 +1424,15 @@ void Solver::incrementStamp() {
 // zero in index zero, we have a depth of zero (size - 1).
 int Solver::depth() { return levels.size() - 1; }
 
-void Solver::purgeProcessing() {
+// The conflicts a full run recorded are resolved deepest first. Only the
+// clauses which backjump furthest are learned, all from the same level.
+void Solver::resolveRecordedConflicts() {
 
 	// Initialize minimum to largest possible value.
 	int minDprime = INT32_MAX;
 
 	std::vector<std::vector<int>> clausesToInstall;
+	std::vector<std::vector<int>> hintsToInstall;
 
 	// Visit conflicts in reverse order.
 	for (auto i = conflicts.rbegin(); i != conflicts.rend(); i++){
@@ -847,23 +1444,36 @@ void Solver::purgeProcessing() {
 		int conflictClauseIndex = *i;
 
 		// If a conflict clause was recorded at depth 'd'.  
-		if (conflictClauseIndex > 0) {
-
-			auto& conflictClause = clauses[conflictClauseIndex];
-			auto& conflictClauseLiterals = conflictClause.getLiterals();
-
-			// Resolved conflict is stored in 'b' vector.
-			int dprime = resolveConflict(conflictClauseLiterals, d);
-			removeRedundantLiterals();
+		if (conflictClauseIndex != 0) {
+
+			// Resolved conflict is stored in 'b' vector. A negative entry
+			// is a binary conflict whose second literal was kept aside.
+			int dprime;
+			if (conflictClauseIndex > 0) {
+				auto conflictClause = clauses[conflictClauseIndex];
+				dprime = resolveConflict(conflictClause.begin(), conflictClause.size(), d);
+				removeRedundantLiterals();
+				if (lrat) proofHints(conflictClause.begin(), conflictClause.size(), conflictClause.getId());
+			}
+			else {
+				int binaryConflict[2] = { -conflictClauseIndex, binaryConflicts[d] };
+				dprime = resolveConflict(binaryConflict, 2, d);
+				removeRedundantLiterals();
+				if (lrat) proofHints(binaryConflict, 2, bimp.id(binaryConflict[0] ^ 1, binaryConflict[1] ^ 1));
+			}
 
 			// If new minimum, record it and restart install vector.
 			if (dprime < minDprime) {
 				clausesToInstall.clear();
+				hintsToInstall.clear();
 				minDprime = dprime;
 			}
 
 			// Save the 'b' vector for installation later.
-			if (dprime == minDprime) clausesToInstall.emplace_back(b);
+			if (dprime == minDprime) {
+				clausesToInstall.emplace_back(b);
+				hintsToInstall.emplace_back(hints);
+			}
 		}
 	}
 
@@ -871,249 +1481,549 @@ void Solver::purgeProcessing() {
 	backjump(minDprime);
 
 	// Loop through each clause which must be installed.
-	for (auto clauseToInstall : clausesToInstall) {
+	for (size_t i = 0; i < clausesToInstall.size(); ++i) {
 
 		// Function 'learn' depends on this class' 'b vector' 
 		// containing the clause. Load it first.
-		b = clauseToInstall;
+		b = clausesToInstall[i];
+		hints = hintsToInstall[i];
 		learn(minDprime);
 	}
+}
 
-	// Calculate range scores for all learned clauses.
-	for (auto& x : LS) x = 0;
-	std::vector<int> m(256, 0);
-	for (int c = minl; c < clauses.size(); ++c) {
-		auto& clause = clauses[c];
+void Solver::purgeProcessing() {
+
+	if (reduction == ReductionMode::FullRun) resolveRecordedConflicts();
+	purgeCount++;
+
+	// Gather the local tier. Core clauses, and tier-two clauses used since the
+	// last purge, are kept with a range of zero. Unused tier-two clauses compete
+	// with the local ones this time round.
+	std::vector<int> local;
+	for (int c = minl; c < clauses.size(); c = clauses.next(c)) {
+		auto clause = clauses[c];
+
+		// Problem clauses added after loading are kept regardless.
+		if (!clause.getLearned()) {
+			clause.setRange(0);
+			continue;
+		}
+
+		int lbd = clause.getLbd();
+		bool used = clause.getUsed();
+		clause.setUsed(false);
 
 		// If this clause is a reason for a literal it gets a score of zero.
-		if (clause.getReasonFor() != -1) clause.setRange(0);
-		else {
+		if (clause.getReasonFor() != -1 || lbd <= coreLbd || (lbd <= tierTwoLbd && used)) clause.setRange(0);
+		else local.push_back(c);
+	}
+	int cutoff = reduction == ReductionMode::FullRun ? rangeCutoff(local) : activityCutoff(local);
 
-			int p = 0, r = 0;
-			for (auto lit : clause.getLiterals()) {
+	// Purge clauses whose range is at least the cutoff. Survivors are
+	// slid down over the gaps so the arena stays contiguous and in order.
+	int write = minl;
+	for (int c = minl; c < clauses.size();) {
 
-				auto& v = vfl(lit);
-				auto val = v.getValue();
-				auto level = val >> 1;
+		int next = clauses.next(c);
+		auto proposedClause = clauses[c];
 
-				// If it was set on level 0. 
-				if (level == 0 && v.isTrue(lit)) {
-					clause.setRange(256);
-					break;
-				}
-				else if (level >= 1 && LS[level] < c) {
-					LS[level] = c;
-					++r;
-				}
-				else if (level >= 1 && LS[level] == c && v.isTrue(lit)) {
-					LS[level] = c + 1;
-					++p;
-				}
+		// Purge if range score too large.
+		if (proposedClause.getRange() >= cutoff) {
+			if (proposedClause.getReasonFor() != -1) {
+				std::cout << "Fatal error! Removed clause should not be a reason for any literal!\n";
+				std::cin.get();
+			}
+			if (proof) proof->remove(proposedClause.getId(), proposedClause.begin(), proposedClause.size());
+		}
+		else {
+			if (write != c) {
+				clauses.move(c, write);
+
+				// If the moved clause is a reason for a literal, update the reason property.
+				auto reasonFor = clauses[write].getReasonFor();
+				if (reasonFor != -1) variables[reasonFor].setReason(write);
 			}
-			int a = (int) std::floor(16.0 * (p + clauseAlpha * (r - p)));
-			r = (int) std::min(a, 255);
-			m[r]++;
-			clause.setRange(r);
+			write = clauses.next(write);
 		}
+		c = next;
 	}
-	
-	// Remove some learned clauses.
-	int T = (clauses.size() - minl) / 2; // Number of learned clauses to retain.
+	clauses.truncate(write);
+
+	// Learned clause references have changed.
+	watchLearnedClauses();
+
+	capDelta += lowerDelta;
+	purgeThreshold += capDelta;
+
+	// Probing and vivification may spend a share of the propagation done since they last ran.
+	double searched = static_cast<double>(propagations - inprocessedPropagations);
+	probeBudget = static_cast<long long>(probeEffort * searched);
+	vivifyBudget = static_cast<long long>(vivifyEffort * searched);
+	inprocessedPropagations = propagations;
+}
+
+// Range scores need the complete trail of a full run. The cutoff is the
+// smallest range at which more than half the local clauses are kept.
+int Solver::rangeCutoff(const std::vector<int>& local) {
+
+	std::vector<int> m(257, 0);
+	for (int c : local) {
+		auto clause = clauses[c];
+		incrementStamp();
+		int r = rangeScore(clause.begin(), clause.size(), stamp);
+		m[r]++;
+		clause.setRange(r);
+	}
+
+	// Number of local clauses to retain.
+	int T = static_cast<int>(local.size()) / 2;
 
 	// Find the number of elements of vector 'm' needed such that
 	// their sum.
 	int sum = 0;
 	int j = 0;
-	while (sum <= T) sum += m[j++];
-	sum -= m[j - 1];
-	int tieBreakers = T - sum;
+	while (j < 256 && sum <= T) sum += m[j++];
+	return j;
+}
 
-	// Purge clauses whose range is greater than or equal to j.
-	// Book says do in order. Am I allowed to swap and pop?
-	for (int i = minl; i < clauses.size();) {
-		
-		// Get the clause at this index.
-		auto& proposedClause = clauses[i];
+// Clauses are ranked by activity, most active first, and the rank scaled to a
+// range below 256. The more active half is kept.
+int Solver::activityCutoff(const std::vector<int>& local) {
 
-		// Purge if range score too large.
-		if (proposedClause.getRange() >= j) {
+	std::vector<std::pair<double, int>> ranked;
+	ranked.reserve(local.size());
+	for (int c : local) ranked.emplace_back(-clauses[c].getActivity(), c);
+	std::sort(ranked.begin(), ranked.end());
 
-			// Swap clause to delete with last clause.
-			std::iter_swap(clauses.begin() + i, clauses.end() - 1);
+	long long count = static_cast<long long>(ranked.size());
+	for (long long i = 0; i < count; ++i) clauses[ranked[i].second].setRange(static_cast<int>(256 * i / count));
+	return 128;
+}
 
-			// Update moved clause so that it has the new clause number and
-			// inform the watched variables that the number is changed.
-			auto& newClause = clauses[i];
-			int originalClauseNumber = newClause.getClauseNumber();
+// Drop the watches on clauses beyond minl and watch them again. The first two
+// literals of each are still the watched pair.
+void Solver::watchLearnedClauses() {
+	variables.removeWatchesFrom(minl);
+	for (int c = minl; c < clauses.size(); c = clauses.next(c)) {
+		auto clause = clauses[c];
+		int wl0 = clause[0];
+		int wl1 = clause[1];
+		vfl(wl0).addToWatch(c, wl1, !(wl0 & 1));
+		vfl(wl1).addToWatch(c, wl0, !(wl1 & 1));
+	}
+}
 
-			auto& literals = newClause.getLiterals();
-			auto wl0 = literals[0];
-			auto wl1 = literals[1];
-			auto& wv0 = vfl(wl0);
-			auto& wv1 = vfl(wl1);
+// A root is a literal with binary implications of its own which no binary
+// clause implies. Deciding it alone on level 1 and propagating either fails,
+// in which case conflict analysis learns a unit as usual, or shows that every
+// literal assigned is implied by the root. Those forced by long clauses get the
+// hyper-binary resolvent (~root OR literal), so binary propagation reaches them
+// directly from then on.
+void Solver::probeProcessing() {
+
+	if (depth() > 0) backjump(0);
+	while (G < static_cast<int>(trail.size())) if (checkForcing(trail[G++])) return;
+
+	auto implies = [&](int l) { return bimp.begin(l) != bimp.end(l) || !bimp.overflow(l).empty(); };
+
+	int literalCount = 2 * (n + 1);
+	std::vector<int> forced;
+	for (int tried = 2; tried < literalCount && probeBudget > 0; ++tried) {
+
+		int root = probeCursor;
+		probeCursor = probeCursor + 1 < literalCount ? probeCursor + 1 : 2;
+		if (!vfl(root).isFree() || !implies(root) || implies(root ^ 1)) continue;
+
+		uint64_t before = propagations;
+		beginLevel();
+		addForcedLiteralToTrail(root, 0);
+		int start = levels[1];
+		bool conflict = false;
+		while (!conflict && G < static_cast<int>(trail.size())) conflict = checkForcing(trail[G++]);
+		probeBudget -= static_cast<long long>(propagations - before);
+
+		// The learned unit is on level 0 already. Propagate it there.
+		if (conflict) {
+			while (G < static_cast<int>(trail.size())) if (checkForcing(trail[G++])) return;
+			continue;
+		}
 
-			// Inform the watched variables that the clause number has changed.
-			wv0.removeFromWatch(originalClauseNumber, !(wl0 & 1));
-			wv1.removeFromWatch(originalClauseNumber, !(wl1 & 1));
-			wv0.addToWatch(i, !(wl0 & 1));
-			wv1.addToWatch(i, !(wl1 & 1));
+		forced.clear();
+		for (size_t t = start + 1; t < trail.size(); ++t) if (vfl(trail[t]).getReason() > 0) forced.push_back(trail[t]);
+		for (int literal : forced) {
+			int id = ++lastId;
+			if (proof) {
+				b = { root ^ 1, literal };
+				if (lrat) {
+					auto reason = clauses[vfl(literal).getReason()];
+					proofHints(reason.begin(), reason.size(), reason.getId());
+				}
+				proof->add(id, b.data(), 2, hints);
+			}
+			bimp.addClause(root ^ 1, literal, id);
+		}
 
-			newClause.setClauseNumber(i); // Inform clause of its new clause number.
+		backjump(0);
+		transitiveReduction(root);
+	}
 
-			// If the moved clause is a reason for a literal, update the reason property.
-			auto reasonFor = newClause.getReasonFor();
-			if (reasonFor != -1) variables[reasonFor].setReason(i);
-			
-			auto& removedClause = clauses.back();
-			auto& removedClauseLiterals = removedClause.getLiterals();
-			int rl0 = removedClauseLiterals[0];
-			int rl1 = removedClauseLiterals[1];
-			auto& rv0 = vfl(rl0);
-			auto& rv1 = vfl(rl1);
-			rv0.removeFromWatch(i, !(rl0 & 1));
-			rv1.removeFromWatch(i, !(rl1 & 1));
-
-			if (removedClause.getReasonFor() != -1) {
-				std::cout << "Fatal error! Removed clause should not be a reason for any literal!\n";
-				std::cin.get();
+	probeBudget = 0;
+}
+
+// Vivify learned clauses at level 0, those with the lowest range first. The
+// complements of a clause's literals are assumed on level 1 one at a time
+// while learned clauses are unwatched, so the clause can't propagate itself.
+// A literal found false is dropped. A literal found true, or a conflict, ends
+// the clause at the decisions which led there. Shortened clauses are written
+// back in place and the arena is compacted afterwards; units go to level 0 and
+// binary clauses to the bimp table.
+void Solver::vivifyProcessing() {
+
+	if (depth() > 0) backjump(0);
+	while (G < static_cast<int>(trail.size())) if (checkForcing(trail[G++])) return;
+
+	std::vector<int> candidates;
+	for (int c = minl; c < clauses.size(); c = clauses.next(c)) {
+		auto clause = clauses[c];
+		if (clause.getLearned() && clause.getReasonFor() == -1) candidates.push_back(c);
+	}
+	std::stable_sort(candidates.begin(), candidates.end(), [&](int x, int y) { return clauses[x].getRange() < clauses[y].getRange(); });
+
+	variables.removeWatchesFrom(minl);
+	int firstUnit = static_cast<int>(trail.size());
+
+	// New sizes of the clauses changed, 0 for those to remove.
+	std::vector<std::pair<int, int>> resized;
+	std::vector<int> literals;
+	std::vector<int> original;
+
+	for (int c : candidates) {
+
+		if (vivifyBudget <= 0 || solutionFailed) break;
+
+		auto clause = clauses[c];
+		original.assign(clause.begin(), clause.end());
+
+		// Literals fixed at level 0 since the clause was learned.
+		literals.clear();
+		bool satisfied = false;
+		for (int literal : original) {
+			auto v = vfl(literal);
+			if (v.isFree() || (v.getValue() >> 1) > 0) literals.push_back(literal);
+			else if (v.isTrue(literal)) satisfied = true;
+		}
+		if (satisfied) {
+			if (proof) proof->remove(clause.getId(), original.data(), static_cast<int>(original.size()));
+			resized.emplace_back(c, 0);
+			continue;
+		}
+
+		uint64_t before = propagations;
+		beginLevel();
+		int implied = 0;
+		bool conflict = false;
+		b.clear();
+		for (size_t k = 0; k < literals.size() && !conflict; ++k) {
+			int literal = literals[k];
+			auto v = vfl(literal);
+			if (v.isFalse(literal)) continue;
+			if (v.isTrue(literal)) {
+				implied = literal;
+				break;
+			}
+			b.push_back(literal);
+			if (k + 1 == literals.size()) break;
+			addForcedLiteralToTrail(literal ^ 1, 0);
+			probing = true;
+			while (!conflict && G < static_cast<int>(trail.size())) conflict = checkForcing(trail[G++]);
+			probing = false;
+		}
+		vivifyBudget -= static_cast<long long>(propagations - before) + 1;
+
+		// Only the decisions the conflict, or the implied literal, rests on are needed.
+		int conflictSize = 0;
+		int conflictId = 0;
+		int binaryConflict[2];
+		const int* conflictLiterals = nullptr;
+		if (conflict || implied) {
+
+			if (conflict && probeConflict > 0) {
+				auto conflictClause = clauses[probeConflict];
+				conflictLiterals = conflictClause.begin();
+				conflictSize = conflictClause.size();
+				conflictId = conflictClause.getId();
+			}
+			else if (conflict) {
+				binaryConflict[0] = -probeConflict;
+				binaryConflict[1] = probeBinaryConflict;
+				conflictLiterals = binaryConflict;
+				conflictSize = 2;
+				conflictId = lrat ? bimp.id(binaryConflict[0] ^ 1, binaryConflict[1] ^ 1) : 0;
+			}
+			else {
+				auto v = vfl(implied);
+				if (v.getReason() > 0) {
+					auto reasonClause = clauses[v.getReason()];
+					conflictLiterals = reasonClause.begin();
+					conflictSize = reasonClause.size();
+				}
+				else {
+					binaryConflict[0] = implied;
+					binaryConflict[1] = -v.getReason() ^ 1;
+					conflictLiterals = binaryConflict;
+					conflictSize = 2;
+				}
+				conflictId = lrat ? reasonId(implied, v.getReason()) : 0;
 			}
-			// Processing complete. Remove clause.
-			clauses.pop_back();
 
-			// Don't increment i. Swap has placed next value at current index.
+			incrementStamp();
+			for (int j = 0; j < conflictSize; ++j) {
+				auto v = vfl(conflictLiterals[j]);
+				if ((v.getValue() >> 1) > 0) v.setStamp(stamp);
+			}
+			b.clear();
+			if (implied) b.push_back(implied);
+			for (int t = static_cast<int>(trail.size()) - 1; t >= levels[1]; --t) {
+				auto v = vfl(trail[t]);
+				if (v.getStamp() != stamp) continue;
+				int reason = v.getReason();
+				if (reason == 0) b.push_back(trail[t] ^ 1);
+				else if (reason > 0) {
+					auto reasonClause = clauses[reason];
+					for (int j = 1, len = reasonClause.size(); j < len; ++j) {
+						auto u = vfl(reasonClause[j]);
+						if ((u.getValue() >> 1) > 0) u.setStamp(stamp);
+					}
+				}
+				else {
+					auto u = vfl(-reason);
+					if ((u.getValue() >> 1) > 0) u.setStamp(stamp);
+				}
+			}
 		}
 		else {
-			i++;
+			conflictLiterals = original.data();
+			conflictSize = static_cast<int>(original.size());
+			conflictId = clause.getId();
+		}
+
+		if (b.size() == original.size()) {
+			backjump(0);
+			continue;
+		}
+
+		int id = ++lastId;
+		if (proof) {
+			if (lrat) proofHints(conflictLiterals, conflictSize, conflictId);
+			proof->add(id, b.data(), static_cast<int>(b.size()), hints);
+			proof->remove(clause.getId(), original.data(), static_cast<int>(original.size()));
+		}
+		backjump(0);
+
+		if (b.size() == 1) {
+			resized.emplace_back(c, 0);
+			addForcedLiteralToTrail(b[0], 0);
+			unitIds[b[0] >> 1] = id;
+			while (G < static_cast<int>(trail.size())) if (checkForcing(trail[G++])) break;
+		}
+		else if (b.size() == 2) {
+			resized.emplace_back(c, 0);
+			bimp.addClause(b[0], b[1], id);
+		}
+		else {
+			resized.emplace_back(c, static_cast<int>(b.size()));
+			std::copy(b.begin(), b.end(), clause.begin());
+			clause.setLbd(std::min(clause.getLbd(), static_cast<int>(b.size())));
+			clause.setId(id);
 		}
 	}
 
-	capDelta += lowerDelta;
-	purgeThreshold += capDelta;
+	// Close the gaps left by shortened and removed clauses.
+	std::sort(resized.begin(), resized.end());
+	size_t k = 0;
+	int write = minl;
+	for (int c = minl; c < clauses.size();) {
+
+		int next = clauses.next(c);
+		if (k < resized.size() && resized[k].first == c) {
+			int size = resized[k++].second;
+			if (size == 0) {
+				c = next;
+				continue;
+			}
+			clauses.shrink(c, size);
+		}
+		if (write != c) {
+			clauses.move(c, write);
+			auto reasonFor = clauses[write].getReasonFor();
+			if (reasonFor != -1) variables[reasonFor].setReason(write);
+		}
+		write = clauses.next(write);
+		c = next;
+	}
+	clauses.truncate(write);
+	watchLearnedClauses();
+
+	// Units found here were propagated without the learned clauses. Go over them again.
+	G = std::min(G, firstUnit);
+	vivifyBudget = 0;
 }
 
-// Flush literals from the trail if heuristics determine it is advised. 
-// Otherwise return immediately. 
-void Solver::flushProcessing() {
+// An implication root -> target is redundant if the other implications of the
+// root reach the target through binary clauses alone. The root's implications
+// are consistent, since probing it found no conflict, so variable stamps can
+// mark the literals reached.
+void Solver::transitiveReduction(int root) {
 
+	std::vector<int> successors(bimp.begin(root), bimp.end(root));
+	successors.insert(successors.end(), bimp.overflow(root).begin(), bimp.overflow(root).end());
+	std::vector<int> reached;
 
-	flushThreshold += vf;
-	if ((uf & -uf) == vf) {
-		uf++;
-		vf = 1;
-		thetaF = std::pow(2, 32) * psi; // Check this double and int math.
+	for (size_t i = 0; i < successors.size() && probeBudget > 0;) {
+
+		int target = successors[i];
+		incrementStamp();
+		reached.clear();
+		bool found = false;
+		auto visit = [&](int l) {
+			if (l == target) found = true;
+			else if (vfl(l).getStamp() != stamp) {
+				vfl(l).setStamp(stamp);
+				reached.push_back(l);
+			}
+		};
+
+		for (int s : successors) if (s != target) visit(s);
+		for (size_t j = 0; j < reached.size() && !found; ++j) {
+			int l = reached[j];
+			for (const int* next = bimp.begin(l), *last = bimp.end(l); next != last; ++next) visit(*next);
+			for (int next : bimp.overflow(l)) visit(next);
+			probeBudget -= (bimp.end(l) - bimp.begin(l)) + static_cast<long long>(bimp.overflow(l).size());
+		}
+
+		if (!found) {
+			++i;
+			continue;
+		}
+
+		int clause[2] = { root ^ 1, target };
+		if (proof) proof->remove(bimp.id(root, target), clause, 2);
+		bimp.removeClause(root ^ 1, target);
+		successors.erase(successors.begin() + i);
 	}
-	else {
-		vf *= 2;
-		thetaF += (thetaF >> 4);
-	}
-
-	/*auto a = agility / std::pow(2, 32);
-
-	// Below we return if it's not time to flush. 
-	switch (flushCapDelta) {
-	case 1:
-		if (a > std::pow(theta, 0) * psi) return;
-	case 2:
-		if (a > std::pow(theta, 1) * psi) return;
-	case 3:
-		if (a > std::pow(theta, 2) * psi) return;
-	case 4:
-		if (a > std::pow(theta, 3) * psi) return;
-	case 5:
-		if (a > std::pow(theta, 4) * psi) return;
-	case 6:
-		if (a > std::pow(theta, 5) * psi) return;
-	case 7:
-		if (a > std::pow(theta, 6) * psi) return;
-	case 8:
-		if (a > std::pow(theta, 7) * psi) return;
-	case 9:
-		if (a > std::pow(theta, 8) * psi) return;
-	case 10:
-		if (a > std::pow(theta, 9) * psi) return;
-	case 11:
-		if (a > std::pow(theta, 10) * psi) return;
-	case 12:
-		if (a > std::pow(theta, 11) * psi) return;
-	case 13:
-		if (a > std::pow(theta, 12) * psi) return;
-	case 14:
-		if (a > std::pow(theta, 13) * psi) return;
-	case 15:
-		if (a > std::pow(theta, 14) * psi) return;
-	} */
-
-	if (agility <= thetaF) {
-		auto maxActivity = heap.queryMaxFreeVariable()->getActivity();
-
-		// !!!!!!!!!!!! Knuth's book does not mention any check for dprime not exceeding levels. Why does my code need it?
-		int dprime = 0;
-		while (dprime < (levels.size() -1) && vfl(trail[levels[dprime + 1]]).getActivity() >= maxActivity) dprime++;
-		if (dprime < depth()) {
-			backjump(dprime);
+}
+
+// Count the levels r among a clause's literals, and p of those levels
+// holding a true literal. References increase from clause to clause, so
+// purgeProcessing can mark with the reference itself. Clauses satisfied at
+// level 0 are always purged.
+int Solver::rangeScore(const int* clause, int size, size_t mark) {
+
+	int p = 0, r = 0;
+	for (int i = 0; i < size; ++i) {
+
+		int lit = clause[i];
+		auto v = vfl(lit);
+		auto level = v.getValue() >> 1;
+
+		// If it was set on level 0. 
+		if (level == 0 && v.isTrue(lit)) return 256;
+		else if (level >= 1 && LS[level] < mark) {
+			LS[level] = mark;
+			++r;
+		}
+		else if (level >= 1 && LS[level] == mark && v.isTrue(lit)) {
+			LS[level] = mark + 1;
+			++p;
 		}
 	}
+
+	int a = (int) std::floor(16.0 * (p + clauseAlpha * (r - p)));
+	return std::min(a, 255);
+}
+
+// Flush literals from the trail. The restart policy has decided when; the
+// trail decides how far. Levels whose decisions are at least as active as the
+// most active free variable would be decided again straight away, so they are
+// kept rather than undone and redone.
+void Solver::flushProcessing() {
+
+	auto maxActivity = activity[heap.queryMaxFreeVariable()];
+
+	// !!!!!!!!!!!! Knuth's book does not mention any check for dprime not exceeding levels. Why does my code need it?
+	// Assumption levels are never flushed; some of them may be empty.
+	int dprime = std::min(static_cast<int>(assumptions.size()), depth());
+	while (dprime < static_cast<int>(levels.size()) - 1 && activity[trail[levels[dprime + 1]] >> 1] >= maxActivity) dprime++;
+	if (dprime < depth()) {
+		backjump(dprime);
+	}
+}
+
+// The first literal of 'b' was just unassigned by the backjump. It belongs to
+// the level of the conflict, which no other literal of 'b' is on. Levels are
+// marked in LS with a fresh stamp.
+int Solver::literalBlockDistance() {
+
+	incrementStamp();
+	int distance = 1;
+	for (size_t i = 1, len = b.size(); i < len; ++i) {
+		int level = vfl(b[i]).getValue() >> 1;
+		if (getLevelStamp(level) == stamp) continue;
+		setLevelStamp(level, stamp);
+		distance++;
+	}
+	return distance;
 }
 
 bool Solver::bimpProcessing(int bl) {
 
 	// First, we'd like to see if our bimp table forces any additional
-	// literals or finds any conflicts since it is fast.
-	if (bimp.count(bl)) {
+	// literals or finds any conflicts since it is fast. Literals placed on
+	// the trail from here on are followed in turn.
+	int h = trail.size();
 
-		// Get the current trail size and assign bimp literal.
-		int h = trail.size();
+	while (true) {
 
-		// Place all the forced literals on the trail.
-		for (int forced : bimp[bl]) {
-			bool conflict = takeAccountOf(forced, bl);
-
-			// Did a conflict occur?
-			if (conflict) {
-				int d = depth();
-				if (!fullRun) {
-					if (d == 0) solutionFailed = true;
-					else {
-						std::vector<int> conflictVector{ bl ^ 1, forced ^ 1 }; // forced ^ 1 ?
-						conflictProcessing(conflictVector);
-					}
-					return true;
-				}
-				else {
-					if (conflicts[d] == 0) conflicts[d] = bl ^ 1; // Correct? Don't use the conflict vector, right?
-				}
-			}
+		// Place all the forced literals on the trail. Original binary clauses are
+		// packed contiguously; ones added later sit in the overflow list.
+		for (const int* forced = bimp.begin(bl), *last = bimp.end(bl); forced != last; ++forced) {
+			if (takeAccountOf(*forced, bl) && bimpConflict(bl, *forced)) return true;
 		}
-
-		while (h < trail.size()) {
-
-			int bl = trail[h++];
-
-			// For all the literals forced by the existence of "literal" on trail.
-			if (bimp.count(bl)) {
-				for (int forced : bimp[bl]) {
-
-					// Process the literal. A non-empty vector is returned if a conflict exists. 
-					bool conflict = takeAccountOf(forced, bl);
-
-					// Did a conflict occur?
-					if (conflict) {
-						int d = depth();
-						if (!fullRun) {
-							if (d == 0) solutionFailed;
-							else {
-								std::vector<int> conflictVector{ bl ^ 1, forced ^ 1 };
-								conflictProcessing(conflictVector);
-							}
-							return true;
-						}
-						else {
-							if (conflicts[d] == 0) conflicts[d] = bl ^ 1; // Correct? bl or bl ^ 1?  Don't use the conflict vector, right?
-						}
-					}
-				}
-			}
+		for (int forced : bimp.overflow(bl)) {
+			if (takeAccountOf(forced, bl) && bimpConflict(bl, forced)) return true;
 		}
+
+		if (h == static_cast<int>(trail.size())) return false;
+		bl = trail[h++];
+	}
+}
+
+// Handle the binary clause (~bl OR forced) being falsified. Returns true if
+// propagation must stop, false if the conflict was only recorded for a full run.
+bool Solver::bimpConflict(int bl, int forced) {
+
+	int d = depth();
+	int conflictClause[2] = { bl ^ 1, forced ^ 1 };
+	if (d == 0) {
+		solutionFailed = true;
+		proofEmpty(conflictClause, 2, lrat ? bimp.id(bl, forced) : 0);
+		return true;
+	}
+	else if (probing) {
+		probeConflict = -(bl ^ 1);
+		probeBinaryConflict = forced ^ 1;
+		return true;
+	}
+	else if (!fullRun) {
+		// Finding the binary clause's id scans its row, so only LRAT pays for it.
+		conflictProcessing(conflictClause, 2, lrat ? bimp.id(bl, forced) : 0);
+		return true;
+	}
+	// Binary clauses have no arena reference. Record the pair instead,
+	// flagged by a negative entry.
+	else if (conflicts[d] == 0) {
+		conflicts[d] = -(bl ^ 1);
+		binaryConflicts[d] = forced ^ 1;
 	}
 	return false;
 }
@@ -1122,24 +2032,18 @@ bool Solver::bimpProcessing(int bl) {
 // of algorithm C.
 bool Solver::takeAccountOf(int l0, int reason) {
 
-	std::vector<int> conflict;
-
-	auto& v = vfl(l0);
+	// One byte tells whether l0 is true, false or free. Nothing is done if it's true.
+	signed char value = variables.literalValue(l0);
 
-	// Don't do anything if l0 is true.
-	if (!v.isTrue(l0)) {
+	// If it's false, we've hit a conflict.
+	if (value < 0) return true;
 
-		// If it's false, we've hit a conflict.
-		if (v.isFalse(l0)) {
-			return true;
-		}
-		// If it's free, make it true by placing it on the trail.
-		else {
-			addForcedLiteralToTrail(l0, -reason);
+	// If it's free, make it true by placing it on the trail.
+	if (value == 0) {
+		addForcedLiteralToTrail(l0, -reason);
 #ifdef DEBUG
-			std::cout << "Bimp processing placing " << l0 << " on trail\n";
+		std::cout << "Bimp processing placing " << l0 << " on trail\n";
 #endif
-		}
 	}
 
 	return false;
@@ -2,13 +2,65 @@
 #define SOLVER_H
 
 #include <vector>
+#include <span>
 #include <math.h>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
 #include "Heap.h"
+#include "Activity.h"
 #include "Clause.h"
 #include "Variable.h"
-#include <unordered_map>
-
+#include "BimpTable.h"
+#include "Formula.h"
+#include "ClauseExchange.h"
+#include "ProofWriter.h"
+#include "Preprocessor.h"
+#include "RestartPolicy.h"
+
+// How learned clauses are purged. FullRun is Knuth's way: search carries on
+// past conflicts until every variable has a value, then ranks clauses by range
+// score on the complete trail. Activity ranks them by clause activity where
+// the search stands, which saves the propagation of the full run.
+enum class ReductionMode { Activity, FullRun };
+
+// Search parameters which may be varied from run to run. Portfolio workers
+// diversify by giving each solver a different set.
+struct SolverParameters {
+
+	// Damping factor for variable activities, and which variables a conflict bumps.
+	double rho = 0.9;
+	BumpTarget bump = BumpTarget::Resolved;
+
+	// Learned clauses allowed before the first purge, and the purge interval growth.
+	int capDelta = 1000;
+	ReductionMode reduction = ReductionMode::FullRun;
+
+	// When to restart. psi is the agility threshold of agility-based flushing,
+	// lubyUnit the number of conflicts in one step of the Luby sequence.
+	RestartKind restarts = RestartKind::Agility;
+	double psi = 0.05;
+	int lubyUnit = 100;
+
+	// Decisions in a thousand which take a random heap variable.
+	int randomPickRate = 20;
+
+	// Learned clauses are shared if they have at most shareSize literals and a
+	// range score no greater than shareRange. Units and binaries always are.
+	int shareSize = 8;
+	int shareRange = 32;
+
+	// Failed-literal probing effort, as a fraction of the literals search has
+	// propagated since the last probing pass. 0 turns probing off.
+	double probeEffort = 0.1;
+
+	// Learned clause vivification effort, on the same terms. 0 turns it off.
+	double vivifyEffort = 0.1;
+
+	// Simplify the problem before the first search. Never done while a proof is logged.
+	bool preprocess = true;
+};
 
 class Solver {
 
@@ -17,12 +69,85 @@ class Solver {
 
 	public:
 
-		Solver(cnf, int seedArgument = -1);
+		// Build a solver clause by clause with reserve and addClause,
+		// or load a whole problem at once.
+		Solver(int seedArgument = -1);
+		Solver(const cnf&, int seedArgument = -1);
+		Solver(const Formula&, int seedArgument = -1);
+
+		// The heap points into this solver's variable and activity tables, so a
+		// copy or a moved-to solver would share the old one's. Neither is allowed.
+		Solver(const Solver&) = delete;
+		Solver& operator=(const Solver&) = delete;
+		Solver(Solver&&) = delete;
+		Solver& operator=(Solver&&) = delete;
+
+		// Size storage ahead of time for a problem of this size.
+		void reserve(int variables, int clauses);
+
+		// Add a clause of DIMACS literals. Clauses may also be added between calls
+		// to Solve; everything learned so far is kept.
+		void addClause(std::span<const int> clause);
+
+		// Must be called before Solve.
+		void setParameters(const SolverParameters& parameters);
+
+		// Solve gives up and returns an empty vector once this flag is set.
+		void setStopFlag(const std::atomic<bool>* flag);
+
+		// Trade learned clauses with other solvers through 'exchange'. Each
+		// solver sharing it needs a distinct source number.
+		void setClauseExchange(ClauseExchange* exchange, int source);
+
+		// Log a proof of unsatisfiability to 'path'. Problem clauses are numbered
+		// from 1 in the order they were added, as LRAT expects. The proof covers a
+		// single solver; clauses imported from other solvers or added between
+		// calls to Solve are not justified in it. Returns false if the file
+		// could not be opened.
+		bool setProof(const std::string& path, ProofFormat format = ProofFormat::DRAT);
+
 		std::vector<bool> Solve();
 
+		// Solve with the given DIMACS literals assumed true. They are decided
+		// one per level ahead of any other decision. If the answer is false
+		// because of them, getFailedAssumptions names the ones responsible.
+		std::vector<bool> Solve(std::span<const int> assumptions);
+
+		// Assumptions which together cannot be satisfied, after Solve returned
+		// false. Empty if the problem has no solution under any assumptions.
+		const std::vector<int>& getFailedAssumptions() const;
+
+		// Lookahead support, used to split a problem into cubes. Levels opened
+		// here are propagated without learning; a conflict just returns false
+		// and the caller closes the level again. Literals are in DIMACS form.
+		bool propagate();
+		bool openLevel(int literal);
+		void closeLevel();
+
+		// Make a literal true on the current level and propagate. At level 0 a
+		// conflict means the problem has no solution.
+		bool imply(int literal);
+
+		// Number of literals a decision would set, or -1 if it leads to a conflict.
+		int probe(int literal);
+
+		bool isFree(int variable);
+		int getVariableCount();
+
+		// Search statistics since construction. Conflicts are counted as they are
+		// analysed, so those a full run passes over are not included.
+		uint64_t getConflictCount() const;
+		uint64_t getPropagationCount() const;
+		int getPurgeCount() const;
+
+		// Keep a variable through preprocessing. Variables used in assumptions are
+		// frozen automatically; freezing the variables of later clauses and
+		// assumptions up front saves restoring everything preprocessing removed.
+		void freeze(int variable);
+
 	private:
 
-		// Indices of min and max learned clauses.
+		// Arena references of min and max learned clauses.
 		int minl = 0;
 		int maxl = 0;
 		int totalLearnedClauses = 0;
@@ -42,46 +167,61 @@ class Solver {
 		// Heap to hold our free variables, sorted by activity.
 		Heap heap;
 
-		// Variables and clauses.
-		std::vector<Clause> clauses;
-		std::vector<Variable> variables;
+		// Variables and clauses. Clauses of length three or more live in the arena.
+		ClauseArena clauses;
+		VariableTable variables;
 		// Trail of literals and a record of the levels.
 		std::vector<int> trail; // F = trail.size()
 		std::vector<int> levels;
-		std::unordered_map<int, std::vector<int>> bimp;
+		BimpTable bimp;
 
 		// Reusable vector for temporarily holding learned clauses.
 		std::vector<int> b;
 
-		// Level stamps.
-		std::vector<int> LS;
+		// Level stamps. No entry exceeds stamp + 1, so a fresh stamp marks levels
+		// without the array having to be cleared first.
+		std::vector<size_t> LS;
+
+		// Scratch space for conflict analysis, kept so that analysis doesn't
+		// allocate once the vectors have grown. redStack holds the literals
+		// being shown redundant, each with the index of the next reason literal.
+		std::vector<std::pair<int, int>> redStack;
+		std::vector<int> hintPending;
+		std::vector<int> hintInvolved;
 
 		// Threshold at which we purge useless learned clauses.
 		int capDelta = 1000;
 		int lowerDelta = 500;
 		int purgeThreshold = capDelta;
 
-		// Flushing parameters.
-		double theta = 17.0 / 16;
-		double psi = 0.05;
-		int flushThreshold = 1;
-		int uf = 1;
-		int vf = 1;
-		uint64_t thetaF = 1;
-
+		// Learned clauses are kept in tiers by LBD. Core clauses are never purged,
+		// tier-two clauses only once a purge finds them unused since the last, and
+		// the rest compete on range score.
+		int coreLbd = 2;
+		int tierTwoLbd = 6;
+		ReductionMode reduction = ReductionMode::FullRun;
+		uint64_t conflictCount = 0;
+		int purgeCount = 0;
+
+		// Restarts. Agility is kept here since every assignment updates it.
+		std::unique_ptr<RestartPolicy> restartPolicy = makeRestartPolicy(RestartKind::Agility, 0.05, 100);
 		int32_t agility = 0;
 
 		// Flag indicating "full runs" being performed.
 		bool fullRun = false;
 
+		// Set while lookahead propagates. Conflicts are reported, not resolved.
+		bool probing = false;
+
 		// Records the first conflict encountered at each level during full runs.
+		// A negative entry is a binary conflict; its second literal is in binaryConflicts.
 		std::vector<int> conflicts;
+		std::vector<int> binaryConflicts;
 
-		// rho is the damping factor used to adjust variable activities.
-		double rho = 0.9; // For some reason much higher values than the book work well for my test cases. 
-
-		// DEL is the amount to increase the variable activity by.
-		double DEL = 1.0;
+		// Variable activities. The damping factor rho is set on the table; for
+		// some reason much higher values than the book work well for my test cases.
+		ActivityTable activity;
+		BumpTarget bumpTarget = BumpTarget::Resolved;
 
 		// Used for clause range calculation.
 		double clauseAlpha = 0.4;
@@ -90,12 +230,76 @@ class Solver {
 		// Flag to indicate that we have failed to find a solution.
 		bool solutionFailed = false;
 
-		// Set when the 'blit' algorithm bumps activity scores.
-		bool heapCorrupted = false;
+		// Seed for the heap and the initial variable order.
+		int seed = 0;
+
+		// Set once all clauses are in and the heap has been built.
+		bool loaded = false;
+
+		// Encoded assumptions of the current Solve, and the DIMACS literals of
+		// the last failed-assumption core.
+		std::vector<int> assumptions;
+		std::vector<int> failedAssumptions;
+
+		// Set by another thread to cancel the search.
+		const std::atomic<bool>* stopFlag = nullptr;
+
+		// Clause sharing state. Imported clauses which can't be installed at the
+		// current level wait in pendingImports, each terminated by 0. The two
+		// buffers trade places on every import, so neither is reallocated.
+		ClauseExchange* exchange = nullptr;
+		int exchangeSource = 0;
+		uint64_t exchangeCursor = 0;
+		int shareSize = 8;
+		int shareRange = 32;
+		std::vector<int> pendingImports;
+		std::vector<int> importBatch;
+
+		// Proof logging. Every clause receives an identifier as it arrives.
+		// unitIds holds, for each variable fixed at level 0, the identifier of
+		// the unit clause which fixed it. 'hints' holds the LRAT hints of the
+		// clause about to be learned.
+		std::unique_ptr<ProofWriter> proof;
+		bool lrat = false;
+		int lastId = 0;
+		std::vector<int> unitIds;
+		std::vector<int> hints;
+
+		// Failed-literal probing and vivification. Each purge sets their budgets,
+		// counted in literals assigned and implications visited. Probing passes
+		// resume at probeCursor. Lookahead conflicts are recorded the way full
+		// runs record theirs.
+		double probeEffort = 0.1;
+		double vivifyEffort = 0.1;
+		long long probeBudget = 0;
+		long long vivifyBudget = 0;
+		uint64_t propagations = 0;
+		uint64_t inprocessedPropagations = 0;
+		int probeCursor = 2;
+		int probeConflict = 0;
+		int probeBinaryConflict = 0;
+
+		// Preprocessing. The preprocessor is kept after it runs to extend
+		// solutions to the variables it eliminated, which stay out of the heap.
+		bool preprocessing = true;
+		std::unique_ptr<Preprocessor> preprocessor;
+		std::vector<bool> frozen;
+		int eliminatedCount = 0;
 
 
 		/* Private methods */
 
+		// Construction steps shared by the constructors.
+		void addVariables(int count);
+		void loadClause(const int* encoded, int size);
+		void watchClause(int clauseNumber);
+		void finishLoading();
+
+		// Replace the problem loaded so far with its simplified form. A clause or
+		// assumption on an eliminated variable brings the removed clauses back.
+		void preprocess();
+		void restoreEliminated();
+
 		// Add elements to trail.
 		void addDecisionVariableToTrail(int variableNumber);
 		void addForcedLiteralToTrail(int literal, int reason);
@@ -103,15 +307,25 @@ class Solver {
 		// Used for the bimp table.
 		bool bimpProcessing(int l0);
 		bool takeAccountOf(int l0, int reason);
+		bool bimpConflict(int bl, int forced);
 
-		// High level conflict handling procedure.
-		void conflictProcessing(std::vector<int>&);
+		// High level conflict handling procedure. 'clauseId' identifies the conflict clause.
+		void conflictProcessing(const int* clause, int size, int clauseId);
 
 		// Modify LS vector.
-		void pushLevelStamp(int value);
+		void pushLevelStamp(size_t value);
 		void popLevelStamp();
-		int getLevelStamp(int index);
-		void setLevelStamp(int index, int value);
+		size_t getLevelStamp(int index);
+		void setLevelStamp(int index, size_t value);
+
+		// Increase a variable's activity and keep the heap in order.
+		bool bumpActivity(Variable v);
+
+		// Start a new decision level.
+		void beginLevel();
+
+		// Work out which assumptions force the assumption 'literal' false.
+		void analyzeFinal(int literal);
 
 		// Select a free variable from heap and make a decision.
 		void makeADecision();
@@ -120,7 +334,7 @@ class Solver {
 		bool checkForcing(int literal);
 
 		// Resolve conflicts which are encountered by force checking.
-		int resolveConflict(const std::vector<int>& clause, int depth = -1);
+		int resolveConflict(const int* clause, int size, int depth = -1);
 
 		// Shorten clauses by removing redundancy. 
 		void removeRedundantLiterals();
@@ -132,20 +346,65 @@ class Solver {
 		// Install the newly learned clause from conflict resolution.
 		void learn(int dprime);
 		
-		// Resolve backlogged conflicts and calculate range scores.
+		// Purge about half of the local tier of learned clauses. After a full run
+		// the conflicts it recorded are resolved first.
 		void purgeProcessing();
-
-		// If agility scores dictate it, flush some literals from the trail.
+		void resolveRecordedConflicts();
+
+		// Give each local clause a range, low for the clauses most worth keeping,
+		// and return the range from which clauses are purged.
+		int rangeCutoff(const std::vector<int>& local);
+		int activityCutoff(const std::vector<int>& local);
+
+		// Range score of a clause. Levels are marked in LS with 'mark' and
+		// 'mark' + 1, so 'mark' must be a fresh stamp. Clauses satisfied at level 0 score 256.
+		int rangeScore(const int* clause, int size, size_t mark);
+
+		// Clause sharing. importClauses returns true if it placed literals on the trail.
+		// attachClause installs a clause once loading has finished.
+		void exportClause();
+		bool importClauses();
+		bool attachClause(int* clause, int size, bool learned);
+
+		// Proof support. proofHints works out the LRAT hints for the clause in 'b'
+		// from the conflict clause it was derived from. proofUnit records a literal
+		// propagated at level 0 as a unit clause of its own, and proofEmpty records
+		// the empty clause once a clause is falsified at level 0.
+		void proofHints(const int* clause, int size, int clauseId);
+		void proofUnit(int literal, int reason);
+		void proofEmpty(const int* clause, int size, int clauseId);
+		void unitHints(const int* literals, int size);
+		int reasonId(int literal, int reason);
+
+		// Flush the proof and report that there is no solution.
+		std::vector<bool> reportFailure();
+
+		// Probe the roots of the binary implication graph at level 0, adding the
+		// units and hyper-binary resolvents found, and drop direct implications
+		// of a root which another chain of implications already gives.
+		void probeProcessing();
+		void transitiveReduction(int root);
+
+		// Shorten learned clauses by propagating the complements of their literals.
+		void vivifyProcessing();
+
+		// Watch the clauses beyond minl afresh after their references changed.
+		void watchLearnedClauses();
+
+		// Restart, keeping the levels whose decisions would be made again at once.
 		void flushProcessing();
 
+		// Number of distinct levels among the literals of the clause in 'b'.
+		int literalBlockDistance();
+
 		// Diagnostic method for checking for duplicates in vector.
 		bool checkVectorForDuplicates(std::vector<int>&);
 
 		void printVector(std::vector<int>&);
 
 		// Convenience functions
-		Variable& vfl(int literal); // Variable object from literal.
-		Variable& vfv(int variable);// Variable object from variable number.
+		Variable vfl(int literal) { return variables[literal >> 1]; } // Variable object from literal.
+		Variable vfv(int variable) { return variables[variable]; }    // Variable object from variable number.
 		void incrementStamp();
 		int depth();
 };
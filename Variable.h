@@ -2,86 +2,145 @@
 #define VARIABLE_H
 
 #include <vector>
-#include <iostream>
+#include <cstddef>
 
 //#define DEBUG
 
-class Variable {
+// A watch on a clause together with a cached "blocker" literal from the same
+// clause. When the blocker is true the clause is satisfied and need not be visited.
+struct Watch {
+	int clause;
+	int blocker;
+};
+
+class Variable;
+
+// The state of every variable, kept as one array per field rather than one
+// object per variable. Propagation reads values and reasons for nearly every
+// literal it meets, so those arrays are dense; watch lists, indexed by the
+// literal they watch, are only reached through a literal which became false.
+// Entry 0 is a dummy, so variables are numbered from 1.
+class VariableTable {
 
 public:
 
-	Variable(int variableNumber);
+	// A view of one variable. It stays valid until the table grows.
+	Variable operator[](int variable);
+
+	size_t size() const { return values.size(); }
+
+	// Add free variables until the table holds 'count' entries.
+	void resize(size_t count);
+	void reserve(size_t count);
+	void clear();
+
+	// Drop every watch on a clause at or beyond the given reference.
+	void removeWatchesFrom(int clauseNumber);
+
+	// Value of a literal: 1 true, -1 false, 0 free. The array returned by
+	// literalValues has three readable bytes beyond the last literal.
+	signed char literalValue(int literal) const { return assignment[literal]; }
+	const signed char* literalValues() const { return assignment.data(); }
+
+private:
+
+	friend class Variable;
+
+	// 2 * level + polarity once assigned, -1 while free.
+	std::vector<int> values;
+
+	// The same assignment indexed by literal, one byte each, so testing a
+	// literal is a single load with no arithmetic on the polarity. Vector
+	// watch scans read four bytes at a time, so three spare bytes follow.
+	std::vector<signed char> assignment;
+	static const int assignmentPadding = 3;
+
+	// The reason for the literal assignment: a clause reference, the negated
+	// implying literal of a binary clause, or 0.
+	std::vector<int> reasons;
+	std::vector<int> tlocs;
+	std::vector<size_t> stamps;
 
-	// Value.
-	void setValue(int level);
-	void setValue(int level, int literal);
-	int  getValue();
+	// Branching state. The old value keeps the phase of an unassigned variable.
+	// Activities are kept apart, in an ActivityTable.
+	std::vector<int> ovals;
+	std::vector<int> hlocs;
+
+	// Clauses watching each literal.
+	std::vector<std::vector<Watch>> watches;
+};
+
+// A variable is a view into a VariableTable, much as a Clause is a view into
+// the arena. Views are cheap to copy and reach the table's arrays directly.
+class Variable {
+
+public:
+
+	Variable(VariableTable* table, int variable) : table(table), variable(variable) {}
+
+	// Value. The first form assigns the saved phase, the second makes 'literal' true.
+	void setValue(int level) { setValue(level, table->ovals[variable]); }
+	void setValue(int level, int literal) {
+		table->values[variable] = 2 * level + (literal & 1);
+		table->assignment[2 * variable + (literal & 1)] = 1;
+		table->assignment[2 * variable + (~literal & 1)] = -1;
+	}
+	void unassign() {
+		table->values[variable] = -1;
+		table->assignment[2 * variable] = 0;
+		table->assignment[2 * variable + 1] = 0;
+	}
+	int  getValue() const { return table->values[variable]; }
 
 	// Access old value;
-	int  getOval();
-	void setOval(int);
+	int  getOval() const { return table->ovals[variable]; }
+	void setOval(int v) { table->ovals[variable] = v; }
 
 	// Check if a literal value is true or false.
-	bool isTrue(int literal);
-	bool isFalse(int literal);
+	bool isTrue(int literal) const { return table->assignment[literal] > 0; }
+	bool isFalse(int literal) const { return table->assignment[literal] < 0; }
 
 	// The current literal value.
-	int getCurrentLiteralValue();
+	int getCurrentLiteralValue() const { return 2 * variable + (getValue() & 1); }
 
 	// The variable number of this variable.
-	int getVariableNumber();
+	int getVariableNumber() const { return variable; }
 
 	// The reason for the variable value.
-	void setReason(int r);
-	int getReason();
+	void setReason(int r) { table->reasons[variable] = r; }
+	int getReason() const { return table->reasons[variable]; }
 
-	// Heap location.
-	void setHloc(bool b);
-	bool getHloc();
+	// Heap location. -1 when the variable is not in the heap.
+	void setHloc(int h) { table->hlocs[variable] = h; }
+	int getHloc() const { return table->hlocs[variable]; }
 
 	// Stamp processing.
-	size_t getStamp();
-	void setStamp(size_t s);
+	size_t getStamp() const { return table->stamps[variable]; }
+	void setStamp(size_t s) { table->stamps[variable] = s; }
 
-	// Add a clause number to a watch list.
-	void addToWatch(int clauseNumber, bool value);
-	void removeFromWatch(int clauseNumber, bool value);
+	// Add a clause number to a watch list with the blocker to check first.
+	// 'value' is true for a watch on the positive literal.
+	void addToWatch(int clauseNumber, int blocker, bool value) { table->watches[2 * variable + !value].push_back(Watch{ clauseNumber, blocker }); }
+
+	// Size both watch lists ahead of time.
+	void reserveWatches(int trueCount, int falseCount);
 
 	// Get all clauses which watched the variable but with
 	// the opposite polarity of what it is assigned.
-	std::vector<int>& getContradictedWatchers();
+	std::vector<Watch>& getContradictedWatchers() { return table->watches[2 * variable + !(getValue() & 1)]; }
 
 	// Trail location.
-	void setTloc(int t);
-	int getTloc();
-
-	double getActivity() const;
-	void setActivity(double amount);
-	bool bumpActivity(double amount);
+	void setTloc(int t) { table->tlocs[variable] = t; }
+	int getTloc() const { return table->tlocs[variable]; }
 
-	bool isFree();
-
-	// Threshold after which all variables AND DEL will be rescaled.
-	const double threshold = 10.0e100;
+	bool isFree() const { return getValue() < 0; }
 
 private:
 
-	// Clauses which watch the literal values of this variable.
-	std::vector<int> watchingTrue;
-	std::vector<int> watchingFalse;
-
-
-	// The reason for the literal assignment. It is an index to a clause.
-	int reason = 0;
-
-	// variable attributes. 
-	int variable = -1;
-	size_t stamp = 0;
-	int tloc = -1;
-	bool hloc = false;
-	int val = -1;
-	int oval = 0;
-	double act = 0;
+	VariableTable* table;
+	int variable;
 };
 
-#endif
\ No newline at end of file
+inline Variable VariableTable::operator[](int variable) { return Variable(this, variable); }
+
+#endif
@@ -0,0 +1,88 @@
+#include "WatchScan.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define WATCHSCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+	typedef int (*Scan)(const int* literals, int k, int size, const signed char* values);
+
+	// False is -1, so eight literals are all false exactly when the AND of
+	// their values is -1. One branch covers the eight.
+	int scanScalar(const int* literals, int k, int size, const signed char* values) {
+		for (; k + 8 <= size; k += 8) {
+			const int* l = literals + k;
+			int all = values[l[0]] & values[l[1]] & values[l[2]] & values[l[3]] & values[l[4]] & values[l[5]] & values[l[6]] & values[l[7]];
+			if (all != -1) break;
+		}
+		while (k < size && values[literals[k]] < 0) ++k;
+		return k;
+	}
+
+#ifdef WATCHSCAN_X86
+
+	int lowestBit(unsigned mask) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(mask);
+#endif
+	}
+
+	// Each lane gathers the four bytes starting at its literal's value, so only
+	// the low byte counts. The lane's literal is false when that byte is 0xFF.
+	AVX2_TARGET int scanAvx2(const int* literals, int k, int size, const signed char* values) {
+		const __m256i low = _mm256_set1_epi32(0xFF);
+		for (; k + 8 <= size; k += 8) {
+			__m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(literals + k));
+			__m256i gathered = _mm256_i32gather_epi32(reinterpret_cast<const int*>(values), indices, 1);
+			__m256i isFalse = _mm256_cmpeq_epi32(_mm256_and_si256(gathered, low), low);
+			unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(isFalse)));
+			if (mask != 0xFF) return k + lowestBit(~mask & 0xFF);
+		}
+		return scanScalar(literals, k, size, values);
+	}
+
+	// AVX2 needs the processor to have it and the operating system to save the
+	// wide registers.
+	bool hasAvx2() {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) return false;
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+
+#endif
+
+	Scan chooseScan() {
+#ifdef WATCHSCAN_X86
+		if (hasAvx2()) return scanAvx2;
+#endif
+		return scanScalar;
+	}
+}
+
+int findNonFalseLong(const int* literals, int k, int size, const signed char* values) {
+	static const Scan scan = chooseScan();
+	return scan(literals, k, size, values);
+}
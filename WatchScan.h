@@ -0,0 +1,23 @@
+#ifndef WATCHSCAN_H
+#define WATCHSCAN_H
+
+// Search for a replacement watch: the first literal of a clause, from index
+// 'k' onward, which is not false. 'values' is the per-literal assignment, with
+// -1 for false, and must have readable bytes up to three past the last literal
+// (see VariableTable). Returns 'size' if every literal is false.
+//
+// Short clauses are scanned one literal at a time. Long ones go to a kernel
+// chosen on first use: AVX2 gathers the values of eight literals per step
+// where the processor has it, otherwise a scalar loop tests eight per branch.
+int findNonFalseLong(const int* literals, int k, int size, const signed char* values);
+
+// Literals left to scan at which the vector kernel takes over.
+const int longScan = 16;
+
+inline int findNonFalse(const int* literals, int k, int size, const signed char* values) {
+	if (size - k >= longScan) return findNonFalseLong(literals, k, size, values);
+	while (k < size && values[literals[k]] < 0) ++k;
+	return k;
+}
+
+#endif